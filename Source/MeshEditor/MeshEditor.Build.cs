@@ -36,6 +36,8 @@ public class MeshEditor : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
+				"RHI",
+				"RenderCore",
 				"Slate",
 				"SlateCore",
 				"InputCore",
@@ -47,7 +49,13 @@ public class MeshEditor : ModuleRules
 				"DeveloperSettings",
 				"Projects",
 				"EditorInteractiveToolsFramework",
-				"TypedElementRuntime"
+				"TypedElementRuntime",
+				"MeshDescription",
+				"StaticMeshDescription",
+				"Json",
+				"GeometryCore",
+				"GeometryFramework",
+				"DerivedDataCache"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
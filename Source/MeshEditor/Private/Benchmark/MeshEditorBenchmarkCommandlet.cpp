@@ -0,0 +1,414 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshEditorBenchmarkCommandlet.h"
+#include "MeshEditorBenchmarkTiming.h"
+#include "MeshDescription.h"
+#include "MeshEditorStats.h"
+#include "StaticMeshAttributes.h"
+#include "StaticMeshResources.h"
+#include "Collector/MeshEdgeCollector.h"
+#include "Components/StaticMeshComponent.h"
+#include "Dom/JsonObject.h"
+#include "Engine/StaticMesh.h"
+#include "Helper/MeshBVH.h"
+#include "Helper/MeshDataIterators.h"
+#include "Helper/MeshEdgeTable.h"
+#include "Helper/MeshTopology.h"
+#include "Helper/MeshVertexKDTree.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	using FMeshEditorBenchmark::TimeBest;
+
+	const TCHAR* DefaultTriangleCounts = TEXT("1000,10000,100000,1000000,5000000");
+
+	/** Distance between neighbouring grid vertices of the synthetic meshes */
+	constexpr float GridSpacing = 10.f;
+
+	/** Time of one pipeline stage on one mesh */
+	struct FBenchmarkResult
+	{
+		int32 NumTriangles{0};
+		FString Stage;
+		/** Vertices, triangle sides, edges or queries handled by one run of the stage */
+		int64 NumElements{0};
+		/** Best time over all runs */
+		double Milliseconds{0.0};
+
+		double GetElementsPerSecond() const
+		{
+			return Milliseconds > 0.0 ? NumElements / (Milliseconds * 0.001) : 0.0;
+		}
+	};
+
+	/**
+	* Builds a square grid of about NumTriangles triangles over a rolling height field, so that normals and edge
+	* directions vary like they do on real meshes. Every vertex is shared by up to six triangles.
+	*/
+	UStaticMesh* MakeGridMesh(int32 NumTriangles)
+	{
+		const int32 QuadsPerSide = FMath::Max(FMath::RoundToInt(FMath::Sqrt(NumTriangles * 0.5f)), 1);
+		const int32 VerticesPerSide = QuadsPerSide + 1;
+		const float HalfSize = QuadsPerSide * GridSpacing * 0.5f;
+
+		FMeshDescription MeshDescription;
+		FStaticMeshAttributes Attributes(MeshDescription);
+		Attributes.Register();
+
+		const int32 NumVertices = VerticesPerSide * VerticesPerSide;
+		MeshDescription.ReserveNewVertices(NumVertices);
+		MeshDescription.ReserveNewVertexInstances(NumVertices);
+		MeshDescription.ReserveNewTriangles(QuadsPerSide * QuadsPerSide * 2);
+		MeshDescription.ReserveNewPolygons(QuadsPerSide * QuadsPerSide * 2);
+
+		const FPolygonGroupID PolygonGroup = MeshDescription.CreatePolygonGroup();
+		Attributes.GetPolygonGroupMaterialSlotNames()[PolygonGroup] = TEXT("Default");
+
+		TVertexAttributesRef<FVector3f> Positions = Attributes.GetVertexPositions();
+		TVertexInstanceAttributesRef<FVector3f> Normals = Attributes.GetVertexInstanceNormals();
+		TArray<FVertexInstanceID> VertexInstances;
+		VertexInstances.Reserve(NumVertices);
+		for (int32 Y = 0; Y < VerticesPerSide; ++Y)
+		{
+			for (int32 X = 0; X < VerticesPerSide; ++X)
+			{
+				const float PositionX = X * GridSpacing - HalfSize;
+				const float PositionY = Y * GridSpacing - HalfSize;
+				const float Frequency = 0.05f;
+				const float Amplitude = 2.f * GridSpacing;
+
+				const FVertexID Vertex = MeshDescription.CreateVertex();
+				Positions[Vertex] = FVector3f{
+					PositionX, PositionY,
+					Amplitude * FMath::Sin(PositionX * Frequency) * FMath::Cos(PositionY * Frequency)
+				};
+
+				const FVertexInstanceID VertexInstance = MeshDescription.CreateVertexInstance(Vertex);
+				Normals[VertexInstance] = FVector3f{
+					-Amplitude * Frequency * FMath::Cos(PositionX * Frequency) * FMath::Cos(PositionY * Frequency),
+					Amplitude * Frequency * FMath::Sin(PositionX * Frequency) * FMath::Sin(PositionY * Frequency),
+					1.f
+				}.GetSafeNormal();
+				VertexInstances.Add(VertexInstance);
+			}
+		}
+
+		for (int32 Y = 0; Y < QuadsPerSide; ++Y)
+		{
+			for (int32 X = 0; X < QuadsPerSide; ++X)
+			{
+				const FVertexInstanceID Corner00 = VertexInstances[Y * VerticesPerSide + X];
+				const FVertexInstanceID Corner10 = VertexInstances[Y * VerticesPerSide + X + 1];
+				const FVertexInstanceID Corner01 = VertexInstances[(Y + 1) * VerticesPerSide + X];
+				const FVertexInstanceID Corner11 = VertexInstances[(Y + 1) * VerticesPerSide + X + 1];
+				MeshDescription.CreateTriangle(PolygonGroup, {Corner00, Corner01, Corner11});
+				MeshDescription.CreateTriangle(PolygonGroup, {Corner00, Corner11, Corner10});
+			}
+		}
+
+		UStaticMesh* StaticMesh = NewObject<UStaticMesh>(GetTransientPackage(), NAME_None, RF_Transient);
+		StaticMesh->GetStaticMaterials().Add(FStaticMaterial(nullptr, TEXT("Default")));
+
+		UStaticMesh::FBuildMeshDescriptionsParams BuildParams;
+		BuildParams.bFastBuild = true;
+		BuildParams.bAllowCpuAccess = true;
+		BuildParams.bBuildSimpleCollision = false;
+		BuildParams.bCommitMeshDescription = false;
+		StaticMesh->BuildFromMeshDescriptions({&MeshDescription}, BuildParams);
+		return StaticMesh;
+	}
+
+	/** 1080p perspective view looking down on the bounds at 45 degrees from far enough to see all of them */
+	FMeshDataIterators::FViewProjection MakeViewProjection(const FBoxSphereBounds& Bounds)
+	{
+		const FIntRect ViewRect{0, 0, 1920, 1080};
+		const float HalfFOV = FMath::DegreesToRadians(45.f);
+
+		FMeshDataIterators::FViewProjection View;
+		View.ViewOrigin = Bounds.Origin + FVector{-1.0, 0.0, 1.0}.GetSafeNormal() * Bounds.SphereRadius * 1.5;
+		View.ViewDirection = (Bounds.Origin - View.ViewOrigin).GetSafeNormal();
+		View.ViewRect = ViewRect;
+
+		const FMatrix ViewRotationMatrix = FInverseRotationMatrix(View.ViewDirection.Rotation()) * FMatrix(
+			FPlane(0, 0, 1, 0),
+			FPlane(1, 0, 0, 0),
+			FPlane(0, 1, 0, 0),
+			FPlane(0, 0, 0, 1));
+		const FMatrix ProjectionMatrix = FReversedZPerspectiveMatrix(HalfFOV, ViewRect.Width(), ViewRect.Height(),
+		                                                             GNearClippingPlane);
+		View.ViewProjectionMatrix = FTranslationMatrix(-View.ViewOrigin) * ViewRotationMatrix * ProjectionMatrix;
+		return View;
+	}
+
+	/** Times every stage of the pipeline on one synthetic mesh */
+	void BenchmarkMesh(int32 NumTriangles, int32 Runs, int32 NumPicks, TArray<FBenchmarkResult>& OutResults)
+	{
+		UStaticMesh* StaticMesh = MakeGridMesh(NumTriangles);
+		const FStaticMeshRenderData* RenderData = StaticMesh->GetRenderData();
+		if (!RenderData || RenderData->LODResources.Num() == 0)
+		{
+			UE_LOG(LogMeshEditor, Error, TEXT("Could not build a synthetic mesh of %d triangles"), NumTriangles);
+			return;
+		}
+
+		const FStaticMeshLODResources* LODResources = &RenderData->LODResources[0];
+		UStaticMeshComponent* Component = NewObject<UStaticMeshComponent>(GetTransientPackage(), NAME_None,
+		                                                                  RF_Transient);
+		Component->SetStaticMesh(StaticMesh);
+
+		const int32 MeshTriangles = LODResources->GetNumTriangles();
+		const int32 MeshVertices = LODResources->GetNumVertices();
+		auto AddResult = [&OutResults, MeshTriangles](const TCHAR* Stage, int64 NumElements, double Milliseconds)
+		{
+			OutResults.Add(FBenchmarkResult{MeshTriangles, Stage, NumElements, Milliseconds});
+			UE_LOG(LogMeshEditor, Display, TEXT("%9d triangles  %-24s %10.3f ms %12.2f M/s"), MeshTriangles, Stage,
+			       Milliseconds, OutResults.Last().GetElementsPerSecond() / 1e6);
+		};
+
+		// The sums keep the optimizer from dropping the loops
+		double Checksum = 0.0;
+
+		AddResult(TEXT("VertexIteration"), MeshVertices, TimeBest(Runs, [&]
+		{
+			FMeshDataIterators::ForEachVertex(*LODResources, [&Checksum](uint32, const FVector3f& Position)
+			{
+				Checksum += Position.Z;
+			});
+		}));
+
+		AddResult(TEXT("VertexIterationVirtual"), MeshVertices, TimeBest(Runs, [&]
+		{
+			for (TSharedPtr<FMeshDataIterators::FVertexIterator> It = FMeshDataIterators::MakeVertexIterator(Component);
+			     *It; ++*It)
+			{
+				Checksum += It->Position().Z;
+			}
+		}));
+
+		AddResult(TEXT("EdgeExtraction"), MeshTriangles * 3, TimeBest(Runs, [&]
+		{
+			FMeshDataIterators::ForEachEdge(*LODResources, [&Checksum](uint32 First, uint32 Second)
+			{
+				Checksum += First ^ Second;
+			});
+		}));
+
+		AddResult(TEXT("EdgeExtractionVirtual"), MeshTriangles * 3, TimeBest(Runs, [&]
+		{
+			for (TSharedPtr<FMeshDataIterators::FEdgeIterator> It = FMeshDataIterators::MakeEdgeIterator(Component);
+			     *It; ++*It)
+			{
+				Checksum += It->FirstEndpointIndex() ^ It->SecondEndpointIndex();
+			}
+		}));
+
+		TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> EdgeTable;
+		AddResult(TEXT("EdgeDedup"), MeshTriangles * 3, TimeBest(Runs, [&]
+		{
+			EdgeTable = FMeshEdgeTable::Build(*LODResources);
+		}));
+
+		AddResult(TEXT("BVHBuild"), MeshTriangles, TimeBest(Runs, [&]
+		{
+			Checksum += FMeshBVH::Build(*LODResources, EdgeTable).IsValid();
+		}));
+
+		AddResult(TEXT("KDTreeBuild"), EdgeTable->Positions.Num(), TimeBest(Runs, [&]
+		{
+			Checksum += FMeshVertexKDTree::Build(EdgeTable).IsValid();
+		}));
+
+		AddResult(TEXT("TopologyBuild"), MeshTriangles * 3, TimeBest(Runs, [&]
+		{
+			Checksum += FMeshTopology::Build(*LODResources, EdgeTable)->NumHalfEdges();
+		}));
+
+		const FTransform Transform{FRotator{10.0, 20.0, 30.0}, FVector{1e5, -2e5, 500.0}, FVector{1.5}};
+		FMeshDataIterators::FWorldSpacePositions WorldPositions;
+		AddResult(TEXT("Transform"), EdgeTable->Positions.Num(), TimeBest(Runs, [&]
+		{
+			FMeshDataIterators::TransformPositions(Transform, EdgeTable->Positions, WorldPositions);
+		}));
+
+		const FMeshDataIterators::FViewProjection View =
+			MakeViewProjection(StaticMesh->GetBounds().TransformBy(Transform));
+		FMeshDataIterators::FScreenSpacePositions ScreenPositions;
+		AddResult(TEXT("Projection"), WorldPositions.Num(), TimeBest(Runs, [&]
+		{
+			FMeshDataIterators::ProjectPositions(View, WorldPositions, ScreenPositions);
+		}));
+
+		// Full collector passes, with the per mesh caches built once up front like in the editor
+		FMeshEdgeCollectRequest Request;
+		FMeshEdgeCollectRequest::FComponentInput& Input = Request.Components.AddDefaulted_GetRef();
+		Input.ComponentKey = Component;
+		Input.StaticMesh = StaticMesh;
+		Input.ComponentTransform = Transform;
+		Input.bDirty = true;
+		Request.ViewProjection = View;
+		Request.bCollectWorld = true;
+
+		FMeshEdgeCollector Collector;
+		FMeshEdgeSnapshot Snapshot;
+		Collector.Collect(Request, Snapshot);
+		AddResult(TEXT("CollectWorld"), Snapshot.NumEdges(), TimeBest(Runs, [&]
+		{
+			Collector.Collect(Request, Snapshot);
+		}));
+
+		Request.bCollectWorld = false;
+		Request.bProjectScreen = true;
+		AddResult(TEXT("CollectScreen"), Snapshot.NumEdges(), TimeBest(Runs, [&]
+		{
+			Collector.Collect(Request, Snapshot);
+		}));
+
+		// Queries spread over the view and over the mesh, the same for every run
+		FRandomStream RandomStream(NumTriangles);
+		const FBox WorldBox = StaticMesh->GetBoundingBox().TransformBy(Transform);
+		TArray<FVector2D> PickPositions;
+		TArray<FVector> RayTargets;
+		for (int32 Pick = 0; Pick < NumPicks; ++Pick)
+		{
+			PickPositions.Add(FVector2D{
+				RandomStream.FRandRange(0.f, View.ViewRect.Width()),
+				RandomStream.FRandRange(0.f, View.ViewRect.Height())
+			});
+			RayTargets.Add(FVector{
+				RandomStream.FRandRange(WorldBox.Min.X, WorldBox.Max.X),
+				RandomStream.FRandRange(WorldBox.Min.Y, WorldBox.Max.Y),
+				RandomStream.FRandRange(WorldBox.Min.Z, WorldBox.Max.Z)
+			});
+		}
+
+		const float PickRadius = 6.f;
+		AddResult(TEXT("PickScreen"), NumPicks, TimeBest(Runs, [&]
+		{
+			for (const FVector2D& PickPosition : PickPositions)
+			{
+				Checksum += Snapshot.FindNearestEdge(PickPosition, PickRadius).EdgeIndex;
+				Checksum += Snapshot.FindNearestVertex(PickPosition, PickRadius).VertexIndex;
+			}
+		}));
+
+		AddResult(TEXT("RayCast"), NumPicks, TimeBest(Runs, [&]
+		{
+			for (const FVector& RayTarget : RayTargets)
+			{
+				const FVector Direction = (RayTarget - View.ViewOrigin).GetSafeNormal();
+				FMeshRayHit Hit;
+				Checksum += Snapshot.WorldData->RayCast(View.ViewOrigin, Direction, HALF_WORLD_MAX, Hit);
+			}
+		}));
+
+		TArray<int32> NearestVertices;
+		const int32 NumPoolVertices = Snapshot.WorldData->Positions.Num();
+		AddResult(TEXT("NearestVertices"), NumPicks, TimeBest(Runs, [&]
+		{
+			for (int32 Pick = 0; Pick < NumPicks; ++Pick)
+			{
+				const int32 VertexIndex = int32(uint32(Pick) * 2654435761u % uint32(NumPoolVertices));
+				const FMeshEdgeOwner& Owner = Snapshot.WorldData->Owners[0];
+				Snapshot.WorldData->FindNearestVertices(Snapshot.WorldData->GetWorldPosition(Owner, VertexIndex), 8,
+				                                        NearestVertices, VertexIndex);
+				Checksum += NearestVertices.Num();
+			}
+		}));
+
+		UE_LOG(LogMeshEditor, Verbose, TEXT("Checksum %f"), Checksum);
+		StaticMesh->MarkAsGarbage();
+		Component->MarkAsGarbage();
+	}
+
+	FString ToCSV(const TArray<FBenchmarkResult>& Results)
+	{
+		FString CSV = TEXT("Triangles,Stage,Elements,Milliseconds,ElementsPerSecond\n");
+		for (const FBenchmarkResult& Result : Results)
+		{
+			CSV += FString::Printf(TEXT("%d,%s,%lld,%.4f,%.1f\n"), Result.NumTriangles, *Result.Stage,
+			                       Result.NumElements, Result.Milliseconds, Result.GetElementsPerSecond());
+		}
+		return CSV;
+	}
+
+	FString ToJSON(const TArray<FBenchmarkResult>& Results, int32 Runs)
+	{
+		TArray<TSharedPtr<FJsonValue>> ResultValues;
+		for (const FBenchmarkResult& Result : Results)
+		{
+			const TSharedRef<FJsonObject> ResultObject = MakeShared<FJsonObject>();
+			ResultObject->SetNumberField(TEXT("triangles"), Result.NumTriangles);
+			ResultObject->SetStringField(TEXT("stage"), Result.Stage);
+			ResultObject->SetNumberField(TEXT("elements"), Result.NumElements);
+			ResultObject->SetNumberField(TEXT("milliseconds"), Result.Milliseconds);
+			ResultObject->SetNumberField(TEXT("elementsPerSecond"), Result.GetElementsPerSecond());
+			ResultValues.Add(MakeShared<FJsonValueObject>(ResultObject));
+		}
+
+		const TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+		Root->SetStringField(TEXT("platform"), FString(FPlatformProperties::IniPlatformName()));
+		Root->SetStringField(TEXT("cpu"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+		Root->SetNumberField(TEXT("cores"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+		Root->SetNumberField(TEXT("runs"), Runs);
+		Root->SetArrayField(TEXT("results"), ResultValues);
+
+		FString JSON;
+		const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JSON);
+		FJsonSerializer::Serialize(Root, Writer);
+		return JSON;
+	}
+}
+
+UMeshEditorBenchmarkCommandlet::UMeshEditorBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UMeshEditorBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString TriangleCountList = DefaultTriangleCounts;
+	FParse::Value(*Params, TEXT("Triangles="), TriangleCountList);
+	int32 Runs = 5;
+	FParse::Value(*Params, TEXT("Runs="), Runs);
+	Runs = FMath::Max(Runs, 1);
+	int32 NumPicks = 1000;
+	FParse::Value(*Params, TEXT("Picks="), NumPicks);
+	NumPicks = FMath::Max(NumPicks, 1);
+	FString OutputDirectory = FPaths::ProjectSavedDir() / TEXT("MeshEditorBenchmark");
+	FParse::Value(*Params, TEXT("Output="), OutputDirectory);
+
+	TArray<FString> TriangleCounts;
+	TriangleCountList.ParseIntoArray(TriangleCounts, TEXT(","));
+
+	TArray<FBenchmarkResult> Results;
+	for (const FString& TriangleCount : TriangleCounts)
+	{
+		const int32 NumTriangles = FCString::Atoi(*TriangleCount);
+		if (NumTriangles > 0)
+		{
+			BenchmarkMesh(NumTriangles, Runs, NumPicks, Results);
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		}
+	}
+
+	const FString Timestamp = FDateTime::Now().ToString();
+	const FString CSVPath = OutputDirectory / FString::Printf(TEXT("MeshEditorBenchmark-%s.csv"), *Timestamp);
+	const FString JSONPath = OutputDirectory / FString::Printf(TEXT("MeshEditorBenchmark-%s.json"), *Timestamp);
+	if (!FFileHelper::SaveStringToFile(ToCSV(Results), *CSVPath) ||
+		!FFileHelper::SaveStringToFile(ToJSON(Results, Runs), *JSONPath))
+	{
+		UE_LOG(LogMeshEditor, Error, TEXT("Could not write the benchmark results to %s"), *OutputDirectory);
+		return 1;
+	}
+
+	UE_LOG(LogMeshEditor, Display, TEXT("Wrote %s and %s"), *CSVPath, *JSONPath);
+	return Results.Num() > 0 ? 0 : 1;
+}
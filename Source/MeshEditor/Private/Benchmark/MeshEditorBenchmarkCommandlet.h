@@ -0,0 +1,24 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MeshEditorBenchmarkCommandlet.generated.h"
+
+/**
+ * Times each stage of the mesh data pipeline on synthetic static meshes and writes the results as CSV and JSON.
+ *
+ * UnrealEditor-Cmd <Project> -run=MeshEditorBenchmark -nullrhi [-Triangles=1000,100000] [-Runs=5] [-Picks=1000]
+ * [-Output=<Directory>]
+ */
+UCLASS()
+class UMeshEditorBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMeshEditorBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
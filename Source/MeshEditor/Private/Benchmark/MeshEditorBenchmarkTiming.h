@@ -0,0 +1,24 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+
+/** Timing shared by the benchmark commandlet and the console benchmarks */
+namespace FMeshEditorBenchmark
+{
+	/** Runs Stage Runs times and returns the best time in milliseconds */
+	template <typename StageType>
+	double TimeBest(int32 Runs, StageType&& Stage)
+	{
+		double BestSeconds = DBL_MAX;
+		for (int32 Run = 0; Run < Runs; ++Run)
+		{
+			const double StartSeconds = FPlatformTime::Seconds();
+			Stage();
+			BestSeconds = FMath::Min(BestSeconds, FPlatformTime::Seconds() - StartSeconds);
+		}
+		return BestSeconds * 1000.0;
+	}
+}
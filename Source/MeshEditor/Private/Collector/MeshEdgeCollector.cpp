@@ -0,0 +1,909 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshEdgeCollector.h"
+#include "MeshEditorStats.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "StaticMeshResources.h"
+#include "Engine/StaticMesh.h"
+
+namespace
+{
+	/** Elements handled by one ParallelFor task, large components are split into several ranges */
+	constexpr int32 ElementRangeSize = 16 * 1024;
+
+	/**
+	* Closest point of a projected edge to the query position
+	* @return False if the edge is partly behind the camera
+	*/
+	bool FindClosestPointOnEdge(const FMeshDataIterators::FScreenSpacePositions& ScreenPositions, const FMeshEdge& Edge,
+	                            const FVector2f& Query, float& OutDistanceSquared, float& OutScreenAlpha)
+	{
+		const float FirstDepth = ScreenPositions.Depth[Edge.FirstIndex];
+		const float SecondDepth = ScreenPositions.Depth[Edge.SecondIndex];
+		if (FirstDepth <= 0.f || SecondDepth <= 0.f)
+		{
+			return false;
+		}
+
+		const FVector2f First{ScreenPositions.X[Edge.FirstIndex], ScreenPositions.Y[Edge.FirstIndex]};
+		const FVector2f Direction = FVector2f{ScreenPositions.X[Edge.SecondIndex], ScreenPositions.Y[Edge.SecondIndex]} -
+			First;
+		const float LengthSquared = Direction.SizeSquared();
+		OutScreenAlpha = LengthSquared > SMALL_NUMBER
+			                 ? FMath::Clamp(FVector2f::DotProduct(Query - First, Direction) / LengthSquared, 0.f, 1.f)
+			                 : 0.f;
+		OutDistanceSquared = (First + Direction * OutScreenAlpha - Query).SizeSquared();
+		return true;
+	}
+
+	/**
+	* Calls Visitor with the owner index and BVH triangle of every triangle near the ray. Radius is in world units and
+	* conservatively converted to the local space of each owner.
+	*/
+	template <typename VisitorType>
+	void ForEachTriangleNearRay(const FMeshEdgeWorldData& WorldData, const FVector& Origin, const FVector& Direction,
+	                            double MaxDistance, double Radius, VisitorType&& Visitor)
+	{
+		for (int32 OwnerIndex = 0; OwnerIndex < WorldData.Owners.Num(); ++OwnerIndex)
+		{
+			const FMeshEdgeOwner& Owner = WorldData.Owners[OwnerIndex];
+			const double MinScale = Owner.ComponentTransform.GetScale3D().GetAbs().GetMin();
+			if (!Owner.BVH.IsValid() || MinScale <= SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			const FVector3f LocalOrigin{Owner.ComponentTransform.InverseTransformPosition(Origin)};
+			const FVector3f LocalDirection{Owner.ComponentTransform.InverseTransformVector(Direction)};
+			Owner.BVH->ForEachTriangleNearRay(LocalOrigin, LocalDirection, static_cast<float>(MaxDistance),
+			                                  static_cast<float>(Radius / MinScale), [&](int32 TriangleIndex)
+			                                  {
+				                                  Visitor(OwnerIndex, TriangleIndex);
+			                                  });
+		}
+	}
+
+	/**
+	* @return The vertex tree of the owner, shared with other components of the same static mesh LOD. Skinned and
+	* dynamic meshes get their own tree, over their current pose.
+	*/
+	TSharedPtr<const FMeshVertexKDTree, ESPMode::ThreadSafe> BuildVertexTree(const FMeshEdgeOwner& Owner)
+	{
+		if (Owner.StaticMesh)
+		{
+			// Vertices of a tree built from another version of the edge table would not match the vertex pool
+			TSharedPtr<const FMeshVertexKDTree, ESPMode::ThreadSafe> VertexTree =
+				FMeshVertexKDTree::FindOrBuild(Owner.StaticMesh, Owner.LODIndex);
+			if (VertexTree.IsValid() && &VertexTree->GetEdgeTable() == Owner.EdgeTable.Get())
+			{
+				return VertexTree;
+			}
+		}
+		return FMeshVertexKDTree::Build(Owner.EdgeTable, Owner.Pose);
+	}
+
+	/** Transforms the clusters of an edge table, their edge ranges are left relative to the table */
+	void TransformClusters(const FTransform& LocalToWorld, TConstArrayView<FMeshEdgeCluster> Clusters,
+	                       TArray<FMeshEdgeWorldCluster>& OutClusters)
+	{
+		// Normal cones only survive a uniform scale, a mirroring one flips them
+		const FVector Scale = LocalToWorld.GetScale3D();
+		const bool bKeepsCones = Scale.IsUniform() && Scale.X != 0.0;
+		const double ConeSign = FMath::Sign(Scale.X);
+
+		OutClusters.SetNum(Clusters.Num(), false);
+		for (int32 Index = 0; Index < Clusters.Num(); ++Index)
+		{
+			const FMeshEdgeCluster& Cluster = Clusters[Index];
+			FMeshEdgeWorldCluster& OutCluster = OutClusters[Index];
+			const FBox LocalBounds{FVector{Cluster.Bounds.Min}, FVector{Cluster.Bounds.Max}};
+			OutCluster.Bounds = LocalBounds.TransformBy(LocalToWorld);
+			OutCluster.ConeAxis = bKeepsCones
+				                      ? LocalToWorld.TransformVectorNoScale(FVector{Cluster.ConeAxis}) * ConeSign
+				                      : FVector::ZeroVector;
+			OutCluster.ConeCutoff = bKeepsCones ? Cluster.ConeCutoff : 2.f;
+			OutCluster.FirstEdge = Cluster.FirstEdge;
+			OutCluster.NumEdges = Cluster.NumEdges;
+		}
+	}
+
+	/** @return The table edges that pass the filter, null if it keeps every edge */
+	FMeshEdgeSubsetPtr FilterEdges(const FMeshEdgeTable& EdgeTable, const FMeshEdgeFilter& Filter)
+	{
+		if (Filter.KeepsAllEdges())
+		{
+			return nullptr;
+		}
+
+		TSharedPtr<FMeshEdgeSubset, ESPMode::ThreadSafe> Subset = MakeShared<FMeshEdgeSubset, ESPMode::ThreadSafe>();
+		Subset->EdgeSlots.SetNumUninitialized(EdgeTable.NumEdges());
+		for (int32 EdgeIndex = 0; EdgeIndex < EdgeTable.NumEdges(); ++EdgeIndex)
+		{
+			Subset->EdgeSlots[EdgeIndex] = EnumHasAnyFlags(EdgeTable.GetEdgeClass(EdgeIndex, Filter.CreaseAngle),
+			                                               Filter.Classes)
+				                               ? Subset->Edges.Add(EdgeIndex)
+				                               : INDEX_NONE;
+		}
+		return Subset;
+	}
+
+	/**
+	* Points the edge ranges of the clusters at the kept edges. Clusters are kept even when all their edges are left
+	* out, they still stand for the table cluster of the same index.
+	*/
+	void FilterClusters(const FMeshEdgeSubset& Subset, TArray<FMeshEdgeWorldCluster>& InOutClusters)
+	{
+		int32 NumKeptEdges = 0;
+		for (FMeshEdgeWorldCluster& Cluster : InOutClusters)
+		{
+			const int32 FirstKeptEdge = NumKeptEdges;
+			for (int32 EdgeIndex = Cluster.FirstEdge; EdgeIndex < Cluster.FirstEdge + Cluster.NumEdges; ++EdgeIndex)
+			{
+				NumKeptEdges += Subset.EdgeSlots[EdgeIndex] != INDEX_NONE ? 1 : 0;
+			}
+			Cluster.FirstEdge = FirstKeptEdge;
+			Cluster.NumEdges = NumKeptEdges - FirstKeptEdge;
+		}
+	}
+
+	/** Sorts the runs from First on and merges the overlapping and adjacent ones */
+	void MergeRuns(TArray<FMeshIndexRun>& Runs, int32 First)
+	{
+		TArrayView<FMeshIndexRun> RunsToMerge = MakeArrayView(Runs.GetData() + First, Runs.Num() - First);
+		Algo::SortBy(RunsToMerge, &FMeshIndexRun::First);
+
+		int32 NumMerged = First;
+		for (int32 Index = First; Index < Runs.Num(); ++Index)
+		{
+			const FMeshIndexRun Run = Runs[Index];
+			FMeshIndexRun* LastRun = NumMerged > First ? &Runs[NumMerged - 1] : nullptr;
+			if (LastRun && Run.First <= LastRun->First + LastRun->Num)
+			{
+				LastRun->Num = FMath::Max(LastRun->Num, Run.First + Run.Num - LastRun->First);
+			}
+			else
+			{
+				Runs[NumMerged++] = Run;
+			}
+		}
+		Runs.SetNum(NumMerged, false);
+	}
+}
+
+bool FMeshEdgeWorldData::RayCast(const FVector& Origin, const FVector& Direction, double MaxDistance,
+                                 FMeshRayHit& OutHit) const
+{
+	OutHit = FMeshRayHit{};
+	float BestDistance = static_cast<float>(MaxDistance);
+	for (int32 OwnerIndex = 0; OwnerIndex < Owners.Num(); ++OwnerIndex)
+	{
+		const FMeshEdgeOwner& Owner = Owners[OwnerIndex];
+		if (!Owner.BVH.IsValid())
+		{
+			continue;
+		}
+
+		// The local direction is not normalized so that distances along the ray are the same in both spaces
+		const FVector3f LocalOrigin{Owner.ComponentTransform.InverseTransformPosition(Origin)};
+		const FVector3f LocalDirection{Owner.ComponentTransform.InverseTransformVector(Direction)};
+		float Distance;
+		int32 TriangleIndex;
+		if (Owner.BVH->RayCast(LocalOrigin, LocalDirection, BestDistance, Distance, TriangleIndex))
+		{
+			BestDistance = Distance;
+			OutHit.OwnerIndex = OwnerIndex;
+			OutHit.TriangleIndex = TriangleIndex;
+			OutHit.Distance = Distance;
+		}
+	}
+
+	if (OutHit.IsValid())
+	{
+		OutHit.Position = Origin + Direction * OutHit.Distance;
+	}
+	return OutHit.IsValid();
+}
+
+int32 FMeshEdgeWorldData::FindNearestVertexToRay(const FVector& Origin, const FVector& Direction, double MaxDistance,
+                                                 double Radius) const
+{
+	int32 BestVertex = INDEX_NONE;
+	double BestDistanceSquared = FMath::Square(Radius);
+	ForEachTriangleNearRay(*this, Origin, Direction, MaxDistance, Radius, [&](int32 OwnerIndex, int32 TriangleIndex)
+	{
+		const FMeshEdgeOwner& Owner = Owners[OwnerIndex];
+		const FIntVector& Triangle = Owner.BVH->GetTriangleVertices(TriangleIndex);
+		for (int32 Corner = 0; Corner < 3; ++Corner)
+		{
+			const int32 VertexIndex = Owner.FirstVertex + Triangle[Corner];
+			const FVector Position = GetWorldPosition(Owner, VertexIndex);
+			const double T = FMath::Clamp(FVector::DotProduct(Position - Origin, Direction), 0.0, MaxDistance);
+			const double DistanceSquared = FVector::DistSquared(Position, Origin + Direction * T);
+			if (DistanceSquared < BestDistanceSquared)
+			{
+				BestDistanceSquared = DistanceSquared;
+				BestVertex = VertexIndex;
+			}
+		}
+	});
+	return BestVertex;
+}
+
+int32 FMeshEdgeWorldData::FindNearestEdgeToRay(const FVector& Origin, const FVector& Direction, double MaxDistance,
+                                               double Radius, float& OutAlpha) const
+{
+	int32 BestEdge = INDEX_NONE;
+	double BestDistanceSquared = FMath::Square(Radius);
+	const FVector RayEnd = Origin + Direction * MaxDistance;
+	ForEachTriangleNearRay(*this, Origin, Direction, MaxDistance, Radius, [&](int32 OwnerIndex, int32 TriangleIndex)
+	{
+		const FMeshEdgeOwner& Owner = Owners[OwnerIndex];
+		const FIntVector& TriangleEdges = Owner.BVH->GetTriangleEdges(TriangleIndex);
+		for (int32 Side = 0; Side < 3; ++Side)
+		{
+			const int32 OwnerEdge = Owner.EdgeSubset.IsValid()
+				                        ? Owner.EdgeSubset->EdgeSlots[TriangleEdges[Side]]
+				                        : TriangleEdges[Side];
+			if (OwnerEdge == INDEX_NONE)
+			{
+				continue;
+			}
+
+			const int32 EdgeIndex = Owner.FirstEdge + OwnerEdge;
+			const FMeshEdge& Edge = Edges[EdgeIndex];
+			const FVector First = GetWorldPosition(Owner, Edge.FirstIndex);
+			const FVector Second = GetWorldPosition(Owner, Edge.SecondIndex);
+
+			FVector PointOnEdge;
+			FVector PointOnRay;
+			FMath::SegmentDistToSegmentSafe(First, Second, Origin, RayEnd, PointOnEdge, PointOnRay);
+			const double DistanceSquared = FVector::DistSquared(PointOnEdge, PointOnRay);
+			if (DistanceSquared < BestDistanceSquared)
+			{
+				BestDistanceSquared = DistanceSquared;
+				BestEdge = EdgeIndex;
+				const double Length = FVector::Dist(First, Second);
+				OutAlpha = Length > SMALL_NUMBER ? static_cast<float>(FVector::Dist(First, PointOnEdge) / Length) : 0.f;
+			}
+		}
+	});
+	return BestEdge;
+}
+
+void FMeshEdgeWorldData::FindNearestVertices(const FVector& Position, int32 K, TArray<int32>& OutVertexIndices,
+                                             int32 ExcludedVertex) const
+{
+	OutVertexIndices.Reset();
+	if (K <= 0)
+	{
+		return;
+	}
+
+	// Every owner returns its own K nearest in world units, the overall K nearest are among them
+	TArray<TPair<float, int32>> Candidates;
+	TArray<FMeshVertexNeighbor> Neighbors;
+	for (const FMeshEdgeOwner& Owner : Owners)
+	{
+		TSharedPtr<const FMeshVertexKDTree, ESPMode::ThreadSafe> VertexTree;
+		{
+			FScopeLock ScopeLock(&VertexTreeLock);
+			if (!Owner.VertexTree.IsValid())
+			{
+				Owner.VertexTree = BuildVertexTree(Owner);
+			}
+			VertexTree = Owner.VertexTree;
+		}
+		if (!VertexTree.IsValid())
+		{
+			continue;
+		}
+
+		// Rotation does not change distances, scaling the local delta by the absolute scale gives world distances
+		const FVector3f LocalPosition{Owner.ComponentTransform.InverseTransformPosition(Position)};
+		const FVector3f Scale{Owner.ComponentTransform.GetScale3D().GetAbs()};
+		const int32 LocalExcludedVertex = ExcludedVertex >= Owner.FirstVertex &&
+		                                  ExcludedVertex < Owner.FirstVertex + Owner.NumVertices
+			                                  ? ExcludedVertex - Owner.FirstVertex
+			                                  : INDEX_NONE;
+		const float MaxDistanceSquared = Candidates.Num() >= K ? Candidates.Last().Key : BIG_NUMBER;
+		VertexTree->FindNearest(LocalPosition, K, Neighbors, Scale, LocalExcludedVertex, MaxDistanceSquared);
+
+		for (const FMeshVertexNeighbor& Neighbor : Neighbors)
+		{
+			Candidates.Emplace(Neighbor.DistanceSquared, Owner.FirstVertex + Neighbor.VertexIndex);
+		}
+		Algo::SortBy(Candidates, [](const TPair<float, int32>& Candidate)
+		{
+			return Candidate.Key;
+		});
+		if (Candidates.Num() > K)
+		{
+			Candidates.SetNum(K, false);
+		}
+	}
+
+	OutVertexIndices.Reserve(Candidates.Num());
+	for (const TPair<float, int32>& Candidate : Candidates)
+	{
+		OutVertexIndices.Add(Candidate.Value);
+	}
+}
+
+FMeshEdgePickResult FMeshEdgeSnapshot::FindNearestEdge(const FVector2D& ScreenPosition, float MaxDistance,
+                                                       float MaxDepth) const
+{
+	FMeshEdgePickResult Result;
+	if (!HasScreenPositions())
+	{
+		return Result;
+	}
+
+	const FVector2f Query{ScreenPosition};
+	float BestDistanceSquared = FMath::Square(MaxDistance);
+	float BestScreenAlpha = 0.f;
+	const TArray<FMeshEdge>& Edges = WorldData->Edges;
+	ScreenGrid.ForEachEdge(Query, MaxDistance, [&](int32 EdgeIndex)
+	{
+		float DistanceSquared;
+		float ScreenAlpha;
+		if (EdgeIndex == Result.EdgeIndex ||
+			!FindClosestPointOnEdge(ScreenPositions, Edges[EdgeIndex], Query, DistanceSquared, ScreenAlpha) ||
+			DistanceSquared > BestDistanceSquared)
+		{
+			return;
+		}
+
+		// Depth is linear in screen space only after inverting it
+		const float InvFirstDepth = 1.f / ScreenPositions.Depth[Edges[EdgeIndex].FirstIndex];
+		const float InvSecondDepth = 1.f / ScreenPositions.Depth[Edges[EdgeIndex].SecondIndex];
+		const float Depth = 1.f / FMath::Lerp(InvFirstDepth, InvSecondDepth, ScreenAlpha);
+		if (Depth > MaxDepth)
+		{
+			return;
+		}
+
+		BestDistanceSquared = DistanceSquared;
+		BestScreenAlpha = ScreenAlpha;
+		Result.EdgeIndex = EdgeIndex;
+		Result.Depth = Depth;
+	});
+
+	if (Result.IsValid())
+	{
+		const float InvSecondDepth = 1.f / ScreenPositions.Depth[Edges[Result.EdgeIndex].SecondIndex];
+		Result.Alpha = BestScreenAlpha * InvSecondDepth * Result.Depth;
+		Result.Distance = FMath::Sqrt(BestDistanceSquared);
+	}
+	return Result;
+}
+
+FMeshVertexPickResult FMeshEdgeSnapshot::FindNearestVertex(const FVector2D& ScreenPosition, float MaxDistance,
+                                                           float MaxDepth) const
+{
+	FMeshVertexPickResult Result;
+	if (!HasScreenPositions())
+	{
+		return Result;
+	}
+
+	const FVector2f Query{ScreenPosition};
+	float BestDistanceSquared = FMath::Square(MaxDistance);
+	ScreenGrid.ForEachVertex(Query, MaxDistance, [&](int32 VertexIndex)
+	{
+		const float DistanceSquared = (FVector2f{ScreenPositions.X[VertexIndex], ScreenPositions.Y[VertexIndex]} -
+			Query).SizeSquared();
+		if (DistanceSquared <= BestDistanceSquared && ScreenPositions.Depth[VertexIndex] <= MaxDepth)
+		{
+			BestDistanceSquared = DistanceSquared;
+			Result.VertexIndex = VertexIndex;
+			Result.Depth = ScreenPositions.Depth[VertexIndex];
+		}
+	});
+
+	if (Result.IsValid())
+	{
+		Result.Distance = FMath::Sqrt(BestDistanceSquared);
+	}
+	return Result;
+}
+
+FMeshEdgeWorldDataPtr FMeshEdgeCollector::CollectWorldEdges(const FMeshEdgeCollectRequest& Request)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MeshEditor_CollectWorld);
+
+	TMap<TObjectKey<UPrimitiveComponent>, int32> PreviousIndices;
+	PreviousIndices.Reserve(CollectedComponents.Num());
+	for (int32 Index = 0; Index < CollectedComponents.Num(); ++Index)
+	{
+		PreviousIndices.Add(CollectedComponents[Index].ComponentKey, Index);
+	}
+
+	TArray<FCollectedComponent> PreviousComponents = MoveTemp(CollectedComponents);
+	const int32 NumInputs = Request.Components.Num();
+	const bool bFilterChanged = !(Request.EdgeFilter == EdgeFilter);
+	EdgeFilter = Request.EdgeFilter;
+
+	// Resolve edge tables in parallel, building the missing ones concurrently. Skinned meshes share the tables of
+	// their asset LOD and are only skinned again when their pose changed. Dynamic meshes are not cached per asset,
+	// their tables are rebuilt whenever the component hands over a new mesh source.
+	TArray<TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>> EdgeTables;
+	TArray<FMeshSourceDataPtr> MeshSources;
+	TArray<FMeshEdgePosePtr> Poses;
+	TArray<TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe>> BVHs;
+	EdgeTables.SetNum(NumInputs);
+	MeshSources.SetNum(NumInputs);
+	Poses.SetNum(NumInputs);
+	BVHs.SetNum(NumInputs);
+	ParallelFor(NumInputs, [&](int32 InputIndex)
+	{
+		const FMeshEdgeCollectRequest::FComponentInput& Input = Request.Components[InputIndex];
+		if (Input.SkinnedPose.IsSet())
+		{
+			const FMeshSkinnedEdgesPtr SkinnedEdges = FMeshSources::FindOrBuildSkinnedEdges(*Input.SkinnedPose);
+			if (!SkinnedEdges.IsValid())
+			{
+				return;
+			}
+
+			EdgeTables[InputIndex] = SkinnedEdges->EdgeTable;
+			MeshSources[InputIndex] = SkinnedEdges->BindPose;
+			const int32* PreviousIndex = PreviousIndices.Find(Input.ComponentKey);
+			const FCollectedComponent* Previous = PreviousIndex ? &PreviousComponents[*PreviousIndex] : nullptr;
+			if (Previous && Previous->EdgeTable == SkinnedEdges->EdgeTable && Previous->Pose.IsValid() &&
+				Previous->PoseHash == Input.SkinnedPose->PoseHash)
+			{
+				Poses[InputIndex] = Previous->Pose;
+				BVHs[InputIndex] = Previous->BVH;
+			}
+			else
+			{
+				Poses[InputIndex] = FMeshSources::SkinPose(*SkinnedEdges, *Input.SkinnedPose);
+				BVHs[InputIndex] = SkinnedEdges->BVH.IsValid() ? SkinnedEdges->BVH->Refit(Poses[InputIndex]) : nullptr;
+			}
+			return;
+		}
+
+		MeshSources[InputIndex] = Input.MeshSource;
+		if (Input.MeshSource.IsValid())
+		{
+			const int32* PreviousIndex = PreviousIndices.Find(Input.ComponentKey);
+			if (PreviousIndex && PreviousComponents[*PreviousIndex].MeshSource == Input.MeshSource)
+			{
+				const FCollectedComponent& Previous = PreviousComponents[*PreviousIndex];
+				EdgeTables[InputIndex] = Previous.EdgeTable;
+				BVHs[InputIndex] = Previous.BVH;
+			}
+			else
+			{
+				EdgeTables[InputIndex] = FMeshEdgeTable::Build(*Input.MeshSource);
+				BVHs[InputIndex] = FMeshBVH::Build(*Input.MeshSource, EdgeTables[InputIndex]);
+			}
+			return;
+		}
+
+		EdgeTables[InputIndex] = FMeshEdgeTable::FindOrBuild(Input.StaticMesh, Input.LODIndex);
+		BVHs[InputIndex] = FMeshBVH::FindOrBuild(Input.StaticMesh, Input.LODIndex);
+
+		// Indices built from another version of the edge table would not match the vertex pool
+		if (BVHs[InputIndex].IsValid() && &BVHs[InputIndex]->GetEdgeTable() != EdgeTables[InputIndex].Get())
+		{
+			BVHs[InputIndex].Reset();
+		}
+	});
+
+	// Pairs of request input and collected component whose world positions are out of date
+	TArray<TPair<int32, int32>> ComponentsToTransform;
+	CollectedComponents.Reset(NumInputs);
+	for (int32 InputIndex = 0; InputIndex < NumInputs; ++InputIndex)
+	{
+		const FMeshEdgeCollectRequest::FComponentInput& Input = Request.Components[InputIndex];
+		if (!EdgeTables[InputIndex].IsValid())
+		{
+			continue;
+		}
+
+		const int32 CollectedIndex = CollectedComponents.AddDefaulted();
+		FCollectedComponent& Collected = CollectedComponents[CollectedIndex];
+		const int32* PreviousIndex = PreviousIndices.Find(Input.ComponentKey);
+		if (PreviousIndex)
+		{
+			Collected = MoveTemp(PreviousComponents[*PreviousIndex]);
+		}
+
+		// Re-extract world positions only when the component moved, its mesh or pose changed or other edges are
+		// wanted
+		if (!PreviousIndex || Input.bDirty || bFilterChanged || Collected.EdgeTable != EdgeTables[InputIndex] ||
+			Collected.Pose != Poses[InputIndex])
+		{
+			Collected.ComponentKey = Input.ComponentKey;
+			Collected.EdgeTable = EdgeTables[InputIndex];
+			Collected.Pose = Poses[InputIndex];
+			ComponentsToTransform.Emplace(InputIndex, CollectedIndex);
+		}
+		Collected.Owner = Input.Owner;
+		Collected.StaticMesh = Input.StaticMesh;
+		Collected.LODIndex = Input.LODIndex;
+		Collected.MeshSource = MeshSources[InputIndex];
+		Collected.PoseHash = Input.SkinnedPose.IsSet() ? Input.SkinnedPose->PoseHash : 0;
+		Collected.BVH = BVHs[InputIndex];
+		Collected.ComponentTransform = Input.ComponentTransform;
+	}
+
+	ParallelFor(ComponentsToTransform.Num(), [&](int32 Index)
+	{
+		const FMeshEdgeCollectRequest::FComponentInput& Input = Request.Components[ComponentsToTransform[Index].Key];
+		FCollectedComponent& Collected = CollectedComponents[ComponentsToTransform[Index].Value];
+		const FMeshEdgePose* Pose = Collected.Pose.Get();
+		FMeshDataIterators::TransformPositions(Input.ComponentTransform,
+		                                       Pose ? Pose->Positions : Collected.EdgeTable->Positions,
+		                                       Collected.WorldPositions);
+		FMeshDataIterators::TransformNormals(Input.ComponentTransform,
+		                                     Pose ? Pose->Normals : Collected.EdgeTable->Normals,
+		                                     Collected.WorldNormals);
+		TransformClusters(Input.ComponentTransform, Pose ? Pose->Clusters : Collected.EdgeTable->Clusters,
+		                  Collected.WorldClusters);
+
+		Collected.EdgeSubset = FilterEdges(*Collected.EdgeTable, Request.EdgeFilter);
+		if (Collected.EdgeSubset.IsValid())
+		{
+			FilterClusters(*Collected.EdgeSubset, Collected.WorldClusters);
+		}
+	});
+
+	// Every range writes into its own preallocated slice of the pools
+	TSharedPtr<FMeshEdgeWorldData, ESPMode::ThreadSafe> NewWorldData =
+		MakeShared<FMeshEdgeWorldData, ESPMode::ThreadSafe>();
+	BuildRanges(*NewWorldData);
+
+	FVector3f* OutPositions = NewWorldData->Positions.GetData();
+	ParallelFor(VertexRanges.Num(), [&](int32 RangeIndex)
+	{
+		const FElementRange& Range = VertexRanges[RangeIndex];
+		const FCollectedComponent& Collected = CollectedComponents[Range.ComponentIndex];
+
+		for (int32 Index = 0; Index < Range.Num; ++Index)
+		{
+			OutPositions[Range.OutputOffset + Index] = Collected.WorldPositions.GetRelativePosition(Range.First + Index);
+		}
+		FMemory::Memcpy(NewWorldData->Normals.GetData() + Range.OutputOffset,
+		                Collected.WorldNormals.GetData() + Range.First, Range.Num * sizeof(FVector3f));
+	});
+
+	FMeshEdge* OutEdges = NewWorldData->Edges.GetData();
+	ParallelFor(EdgeRanges.Num(), [&](int32 RangeIndex)
+	{
+		const FElementRange& Range = EdgeRanges[RangeIndex];
+		const uint32 FirstVertex = NewWorldData->Owners[Range.ComponentIndex].FirstVertex;
+		const FCollectedComponent& Collected = CollectedComponents[Range.ComponentIndex];
+		const TArray<FMeshEdge>& Edges = Collected.EdgeTable->Edges;
+		const int32* SubsetEdges = Collected.EdgeSubset.IsValid() ? Collected.EdgeSubset->Edges.GetData() : nullptr;
+
+		for (int32 Index = Range.First; Index < Range.First + Range.Num; ++Index)
+		{
+			const FMeshEdge& Edge = Edges[SubsetEdges ? SubsetEdges[Index] : Index];
+			OutEdges[Range.OutputOffset + Index - Range.First] = FMeshEdge{
+				FirstVertex + Edge.FirstIndex, FirstVertex + Edge.SecondIndex
+			};
+		}
+	});
+
+	SET_DWORD_STAT(STAT_MeshEditor_ComponentsCollected, NewWorldData->Owners.Num());
+	SET_DWORD_STAT(STAT_MeshEditor_EdgesCollected, NewWorldData->Edges.Num());
+	SET_DWORD_STAT(STAT_MeshEditor_VerticesCollected, NewWorldData->Positions.Num());
+
+	WorldData = NewWorldData;
+	return WorldData;
+}
+
+void FMeshEdgeCollector::ProjectEdges(const FMeshDataIterators::FViewProjection& ViewProjection, bool bCullBackFaces,
+                                      bool bSilhouettesOnly, FMeshEdgeSnapshot& OutSnapshot)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MeshEditor_ProjectEdges);
+
+	OutSnapshot.ScreenPositions.SetNum(WorldData.IsValid() ? WorldData->Positions.Num() : 0);
+	CullClusters(ViewProjection, bCullBackFaces, OutSnapshot.VisibleVertexRuns, OutSnapshot.VisibleEdgeRuns);
+	if (bSilhouettesOnly && WorldData.IsValid())
+	{
+		TSharedRef<TArray<FMeshEdge>, ESPMode::ThreadSafe> SilhouetteEdges = MakeShared<
+			TArray<FMeshEdge>, ESPMode::ThreadSafe>();
+		FindSilhouetteEdges(ViewProjection, OutSnapshot.VisibleEdgeRuns, *SilhouetteEdges);
+		OutSnapshot.SilhouetteEdges = SilhouetteEdges;
+	}
+
+	// Owners are in the order of the collected components, so the pool runs map back to their world positions
+	TArray<FElementRange> ProjectedRanges;
+	for (const FMeshIndexRun& Run : OutSnapshot.VisibleVertexRuns)
+	{
+		const int32 OwnerIndex = WorldData->FindOwnerOfVertex(Run.First);
+		const int32 FirstInOwner = Run.First - WorldData->Owners[OwnerIndex].FirstVertex;
+		for (int32 Offset = 0; Offset < Run.Num; Offset += ElementRangeSize)
+		{
+			ProjectedRanges.Add(FElementRange{
+				OwnerIndex, FirstInOwner + Offset, FMath::Min(ElementRangeSize, Run.Num - Offset), Run.First + Offset
+			});
+		}
+	}
+
+	FMeshDataIterators::FScreenSpacePositions& OutScreenPositions = OutSnapshot.ScreenPositions;
+	ParallelFor(ProjectedRanges.Num(), [&](int32 RangeIndex)
+	{
+		const FElementRange& Range = ProjectedRanges[RangeIndex];
+		FMeshDataIterators::ProjectPositions(ViewProjection, CollectedComponents[Range.ComponentIndex].WorldPositions,
+		                                     Range.First, Range.First + Range.Num, OutScreenPositions,
+		                                     Range.OutputOffset);
+	});
+
+#if STATS
+	int32 NumProjectedEdges = 0;
+	for (const FMeshIndexRun& Run : OutSnapshot.VisibleEdgeRuns)
+	{
+		NumProjectedEdges += Run.Num;
+	}
+	SET_DWORD_STAT(STAT_MeshEditor_EdgesProjected, NumProjectedEdges);
+#endif
+}
+
+void FMeshEdgeCollector::CullClusters(const FMeshDataIterators::FViewProjection& ViewProjection, bool bCullBackFaces,
+                                      TArray<FMeshIndexRun>& OutVertexRuns, TArray<FMeshIndexRun>& OutEdgeRuns) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMeshEdgeCollector::CullClusters);
+
+	OutVertexRuns.Reset();
+	OutEdgeRuns.Reset();
+	if (!WorldData.IsValid())
+	{
+		return;
+	}
+
+	FConvexVolume Frustum;
+	GetViewFrustumBounds(Frustum, ViewProjection.ViewProjectionMatrix, false);
+
+	for (int32 OwnerIndex = 0; OwnerIndex < WorldData->Owners.Num(); ++OwnerIndex)
+	{
+		const FMeshEdgeOwner& Owner = WorldData->Owners[OwnerIndex];
+		if (!Owner.Bounds.IsValid || !Frustum.IntersectBox(Owner.Bounds.GetCenter(), Owner.Bounds.GetExtent()))
+		{
+			continue;
+		}
+
+		const FMeshEdgeTable& EdgeTable = *CollectedComponents[OwnerIndex].EdgeTable;
+		const int32 FirstOwnerVertexRun = OutVertexRuns.Num();
+		for (int32 ClusterIndex = 0; ClusterIndex < Owner.NumClusters; ++ClusterIndex)
+		{
+			const FMeshEdgeWorldCluster& Cluster = WorldData->Clusters[Owner.FirstCluster + ClusterIndex];
+			if (!Cluster.IsInFrustum(Frustum) || (bCullBackFaces && Cluster.IsBackFacing(
+				ViewProjection.ViewOrigin, ViewProjection.ViewDirection, ViewProjection.bIsPerspective)))
+			{
+				continue;
+			}
+
+			// Clusters cover the edge pool in order, consecutive visible clusters extend the same run. Clusters whose
+			// edges were all filtered out still bring their vertices
+			if (OutEdgeRuns.Num() > 0 && OutEdgeRuns.Last().First + OutEdgeRuns.Last().Num == Cluster.FirstEdge)
+			{
+				OutEdgeRuns.Last().Num += Cluster.NumEdges;
+			}
+			else if (Cluster.NumEdges > 0)
+			{
+				OutEdgeRuns.Add(FMeshIndexRun{Cluster.FirstEdge, Cluster.NumEdges});
+			}
+
+			const FMeshEdgeCluster& TableCluster = EdgeTable.Clusters[ClusterIndex];
+			for (int32 RunIndex = TableCluster.FirstVertexRun;
+			     RunIndex < TableCluster.FirstVertexRun + TableCluster.NumVertexRuns; ++RunIndex)
+			{
+				const FMeshIndexRun& Run = EdgeTable.ClusterVertexRuns[RunIndex];
+				OutVertexRuns.Add(FMeshIndexRun{Owner.FirstVertex + Run.First, Run.Num});
+			}
+		}
+
+		// Neighboring clusters share the vertices along their border, every vertex is projected once
+		MergeRuns(OutVertexRuns, FirstOwnerVertexRun);
+	}
+}
+
+void FMeshEdgeCollector::FindSilhouetteEdges(const FMeshDataIterators::FViewProjection& ViewProjection,
+                                             TArray<FMeshIndexRun>& InOutEdgeRuns, TArray<FMeshEdge>& OutEdges) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMeshEdgeCollector::FindSilhouetteEdges);
+
+	// Runs may span several owners, split them so every piece reads a single edge table
+	struct FOwnerRuns
+	{
+		int32 OwnerIndex;
+		TArray<FMeshIndexRun> Runs;
+		TArray<int32> KeptEdges;
+	};
+	TArray<FOwnerRuns> OwnerRuns;
+	for (const FMeshIndexRun& Run : InOutEdgeRuns)
+	{
+		for (int32 First = Run.First; First < Run.First + Run.Num;)
+		{
+			const int32 OwnerIndex = WorldData->FindOwnerOfEdge(First);
+			const FMeshEdgeOwner& Owner = WorldData->Owners[OwnerIndex];
+			const int32 End = FMath::Min(Run.First + Run.Num, Owner.FirstEdge + Owner.NumEdges);
+			if (OwnerRuns.Num() == 0 || OwnerRuns.Last().OwnerIndex != OwnerIndex)
+			{
+				OwnerRuns.Add(FOwnerRuns{OwnerIndex});
+			}
+			OwnerRuns.Last().Runs.Add(FMeshIndexRun{First, End - First});
+			First = End;
+		}
+	}
+
+	ParallelFor(OwnerRuns.Num(), [&](int32 Index)
+	{
+		FOwnerRuns& Pieces = OwnerRuns[Index];
+		const FMeshEdgeOwner& Owner = WorldData->Owners[Pieces.OwnerIndex];
+		const FMeshEdgeTable& EdgeTable = *CollectedComponents[Pieces.OwnerIndex].EdgeTable;
+		const FMeshEdgePose* Pose = CollectedComponents[Pieces.OwnerIndex].Pose.Get();
+
+		// Directions and positions both go through the inverse transform, which keeps their dot products with the
+		// local normals, non uniform scale included. Mirroring flips every face and leaves the silhouette as is.
+		const FTransform& Transform = Owner.ComponentTransform;
+		const FVector3f LocalEye = ViewProjection.bIsPerspective
+			                           ? FVector3f{Transform.InverseTransformPosition(ViewProjection.ViewOrigin)}
+			                           : FVector3f{Transform.InverseTransformVector(-ViewProjection.ViewDirection)};
+		TArray<uint8> FrontFacing;
+		FMeshDataIterators::ComputeFrontFacing(Pose ? Pose->FacePlanes : EdgeTable.FacePlanes, LocalEye,
+		                                       ViewProjection.bIsPerspective, FrontFacing);
+
+		for (const FMeshIndexRun& Run : Pieces.Runs)
+		{
+			for (int32 PoolEdge = Run.First; PoolEdge < Run.First + Run.Num; ++PoolEdge)
+			{
+				const int32 OwnerEdge = PoolEdge - Owner.FirstEdge;
+				const int32 TableEdge = Owner.EdgeSubset.IsValid() ? Owner.EdgeSubset->Edges[OwnerEdge] : OwnerEdge;
+				const FIntPoint& Faces = EdgeTable.EdgeFaces[TableEdge];
+				if (Faces.Y == INDEX_NONE || FrontFacing[Faces.X] != FrontFacing[Faces.Y])
+				{
+					Pieces.KeptEdges.Add(PoolEdge);
+				}
+			}
+		}
+	});
+
+	InOutEdgeRuns.Reset();
+	OutEdges.Reset();
+	for (const FOwnerRuns& Pieces : OwnerRuns)
+	{
+		for (const int32 PoolEdge : Pieces.KeptEdges)
+		{
+			if (InOutEdgeRuns.Num() > 0 && InOutEdgeRuns.Last().First + InOutEdgeRuns.Last().Num == PoolEdge)
+			{
+				++InOutEdgeRuns.Last().Num;
+			}
+			else
+			{
+				InOutEdgeRuns.Add(FMeshIndexRun{PoolEdge, 1});
+			}
+			OutEdges.Add(WorldData->Edges[PoolEdge]);
+		}
+	}
+}
+
+void FMeshEdgeCollector::Collect(const FMeshEdgeCollectRequest& Request, FMeshEdgeSnapshot& OutSnapshot)
+{
+	OutSnapshot.WorldData = Request.bCollectWorld ? CollectWorldEdges(Request) : WorldData;
+
+	OutSnapshot.ScreenPositions.SetNum(0);
+	OutSnapshot.VisibleVertexRuns.Reset();
+	OutSnapshot.VisibleEdgeRuns.Reset();
+	OutSnapshot.ScreenGrid.Reset();
+	OutSnapshot.SilhouetteEdges.Reset();
+	if (Request.bProjectScreen)
+	{
+		ProjectEdges(Request.ViewProjection, Request.bCullBackFaces, Request.bSilhouettesOnly, OutSnapshot);
+		OutSnapshot.ScreenViewProjection = Request.ViewProjection;
+		if (OutSnapshot.HasScreenPositions())
+		{
+			const FMeshDataIterators::FViewProjection& View = Request.ViewProjection;
+			const FBox2f ScreenBounds{
+				FVector2f{View.ViewRect.Min} / View.DPIScale, FVector2f{View.ViewRect.Max} / View.DPIScale
+			};
+			OutSnapshot.ScreenGrid.Build(OutSnapshot.WorldData->Edges, OutSnapshot.ScreenPositions,
+			                             OutSnapshot.VisibleVertexRuns, OutSnapshot.VisibleEdgeRuns, ScreenBounds);
+		}
+	}
+}
+
+int32 FMeshEdgeCollector::SelectLOD(const UStaticMesh* StaticMesh, const FBoxSphereBounds& Bounds,
+                                    const FMeshDataIterators::FViewProjection& ViewProjection, float PixelThreshold)
+{
+	const FStaticMeshRenderData* RenderData = StaticMesh ? StaticMesh->GetRenderData() : nullptr;
+	if (!RenderData || RenderData->LODResources.Num() == 0)
+	{
+		return 0;
+	}
+
+	// LODs below the first resident one may be streamed out
+	const int32 FirstLOD = FMath::Clamp<int32>(RenderData->CurrentFirstLODIdx, 0, RenderData->LODResources.Num() - 1);
+	if (PixelThreshold <= 0.f)
+	{
+		return FirstLOD;
+	}
+
+	// About half of the triangles face the camera and share the area of the projected bounds
+	const double ScreenRadius = ViewProjection.GetScreenRadius(Bounds.Origin, Bounds.SphereRadius);
+	const double ScreenArea = PI * FMath::Square(ScreenRadius);
+	for (int32 LODIndex = FirstLOD; LODIndex < RenderData->LODResources.Num(); ++LODIndex)
+	{
+		const int32 NumTriangles = RenderData->LODResources[LODIndex].GetNumTriangles();
+		const double EdgeSpacing = FMath::Sqrt(2.0 * ScreenArea / FMath::Max(NumTriangles, 1));
+		if (EdgeSpacing >= PixelThreshold)
+		{
+			return LODIndex;
+		}
+	}
+	return RenderData->LODResources.Num() - 1;
+}
+
+void FMeshEdgeCollector::Reset()
+{
+	CollectedComponents.Empty();
+	VertexRanges.Empty();
+	EdgeRanges.Empty();
+	WorldData.Reset();
+}
+
+void FMeshEdgeCollector::BuildRanges(FMeshEdgeWorldData& OutWorldData)
+{
+	VertexRanges.Reset();
+	EdgeRanges.Reset();
+	OutWorldData.Owners.Reset(CollectedComponents.Num());
+	OutWorldData.Clusters.Reset();
+
+	auto AddRanges = [](TArray<FElementRange>& Ranges, int32 ComponentIndex, int32 NumElements, int32& OutputOffset)
+	{
+		for (int32 First = 0; First < NumElements; First += ElementRangeSize)
+		{
+			const int32 Num = FMath::Min(ElementRangeSize, NumElements - First);
+			Ranges.Add(FElementRange{ComponentIndex, First, Num, OutputOffset});
+			OutputOffset += Num;
+		}
+	};
+
+	// Prefix sums of the vertex and edge counts give every owner and range its pool offsets
+	int32 VertexOffset = 0;
+	int32 EdgeOffset = 0;
+	for (int32 ComponentIndex = 0; ComponentIndex < CollectedComponents.Num(); ++ComponentIndex)
+	{
+		const FCollectedComponent& Collected = CollectedComponents[ComponentIndex];
+
+		FMeshEdgeOwner& Owner = OutWorldData.Owners.AddDefaulted_GetRef();
+		Owner.Actor = Collected.Owner;
+		Owner.ComponentKey = Collected.ComponentKey;
+		Owner.Origin = Collected.WorldPositions.Origin;
+		Owner.ComponentTransform = Collected.ComponentTransform;
+		Owner.StaticMesh = Collected.StaticMesh;
+		Owner.LODIndex = Collected.LODIndex;
+		Owner.MeshSource = Collected.MeshSource;
+		Owner.EdgeTable = Collected.EdgeTable;
+		Owner.Pose = Collected.Pose;
+		Owner.BVH = Collected.BVH;
+		Owner.EdgeSubset = Collected.EdgeSubset;
+		Owner.FirstVertex = VertexOffset;
+		Owner.NumVertices = Collected.WorldPositions.Num();
+		Owner.FirstEdge = EdgeOffset;
+		Owner.NumEdges = Collected.EdgeSubset.IsValid()
+			                 ? Collected.EdgeSubset->Edges.Num()
+			                 : Collected.EdgeTable->NumEdges();
+		Owner.FirstCluster = OutWorldData.Clusters.Num();
+		Owner.NumClusters = Collected.WorldClusters.Num();
+		for (const FMeshEdgeWorldCluster& Cluster : Collected.WorldClusters)
+		{
+			FMeshEdgeWorldCluster& PoolCluster = OutWorldData.Clusters.Add_GetRef(Cluster);
+			PoolCluster.FirstEdge += Owner.FirstEdge;
+			Owner.Bounds += Cluster.Bounds;
+		}
+
+		AddRanges(VertexRanges, ComponentIndex, Owner.NumVertices, VertexOffset);
+		AddRanges(EdgeRanges, ComponentIndex, Owner.NumEdges, EdgeOffset);
+	}
+
+	OutWorldData.Positions.SetNumUninitialized(VertexOffset);
+	OutWorldData.Normals.SetNumUninitialized(VertexOffset);
+	OutWorldData.Edges.SetNumUninitialized(EdgeOffset);
+}
@@ -0,0 +1,393 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ConvexVolume.h"
+#include "Algo/BinarySearch.h"
+#include "Collector/MeshEdgeScreenGrid.h"
+#include "Helper/MeshBVH.h"
+#include "Helper/MeshDataIterators.h"
+#include "Helper/MeshEdgeTable.h"
+#include "Helper/MeshVertexKDTree.h"
+#include "UObject/ObjectKey.h"
+
+/** FMeshEdgeCluster in world space, along with where its edges are in the edge pool */
+struct FMeshEdgeWorldCluster
+{
+	FBox Bounds{ForceInit};
+	FVector ConeAxis{FVector::ZeroVector};
+	/** See FMeshEdgeCluster, above one if the cluster can not be back-face culled */
+	float ConeCutoff{2.f};
+	int32 FirstEdge{0};
+	int32 NumEdges{0};
+
+	bool IsInFrustum(const FConvexVolume& Frustum) const
+	{
+		return Frustum.IntersectBox(Bounds.GetCenter(), Bounds.GetExtent());
+	}
+
+	/** @return True if every triangle adjacent to the edges faces away from the camera */
+	bool IsBackFacing(const FVector& ViewOrigin, const FVector& ViewDirection, bool bIsPerspective) const
+	{
+		if (!bIsPerspective)
+		{
+			return FVector::DotProduct(ViewDirection, ConeAxis) >= ConeCutoff;
+		}
+
+		const FVector ToCenter = Bounds.GetCenter() - ViewOrigin;
+		return FVector::DotProduct(ToCenter, ConeAxis) >= ConeCutoff * ToCenter.Size() + Bounds.GetExtent().Size();
+	}
+};
+
+/** Which edges of the edge tables are collected */
+struct FMeshEdgeFilter
+{
+	EMeshEdgeClass Classes{EMeshEdgeClass::All};
+	/** See UMeshEditorSettings::MeshEdgeCreaseAngle */
+	float CreaseAngle{30.f};
+
+	bool KeepsAllEdges() const
+	{
+		return EnumHasAllFlags(Classes, EMeshEdgeClass::All);
+	}
+
+	bool operator==(const FMeshEdgeFilter& Other) const
+	{
+		return Classes == Other.Classes && CreaseAngle == Other.CreaseAngle;
+	}
+};
+
+/** Edges of one edge table that pass a FMeshEdgeFilter */
+struct FMeshEdgeSubset
+{
+	/** Table edges kept, in table order */
+	TArray<int32> Edges;
+	/** Index in Edges of every table edge, INDEX_NONE for the edges left out */
+	TArray<int32> EdgeSlots;
+};
+
+using FMeshEdgeSubsetPtr = TSharedPtr<const FMeshEdgeSubset, ESPMode::ThreadSafe>;
+
+/** A component whose edges are part of the overlay, and its slices of the vertex and edge pools */
+struct FMeshEdgeOwner
+{
+	AActor* Actor{nullptr};
+	TObjectKey<UPrimitiveComponent> ComponentKey;
+	/** World position the vertex pool slice is relative to */
+	FVector Origin{FVector::ZeroVector};
+	FTransform ComponentTransform;
+	/**
+	* Mesh the edges come from, MeshSource is set instead of StaticMesh for skinned and dynamic meshes. Skinned meshes
+	* hand over their bind pose, which every pose of them shares.
+	*/
+	const UStaticMesh* StaticMesh{nullptr};
+	int32 LODIndex{0};
+	FMeshSourceDataPtr MeshSource;
+	/** Table the pool slices were filled from */
+	TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> EdgeTable;
+	/** Pose of the table the pool slices were filled from, null unless the mesh is skinned */
+	FMeshEdgePosePtr Pose;
+	/** Triangles of the mesh, their vertices and edges are those of the pool slices */
+	TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> BVH;
+	/**
+	* Nearest neighbor index over the vertices of the pool slice, built by the first FindNearestVertices call that
+	* reaches the owner. Guarded by FMeshEdgeWorldData::VertexTreeLock.
+	*/
+	mutable TSharedPtr<const FMeshVertexKDTree, ESPMode::ThreadSafe> VertexTree;
+	/** Table edges in the edge pool slice, null when it holds every edge of the table */
+	FMeshEdgeSubsetPtr EdgeSubset;
+	int32 FirstVertex{0};
+	int32 NumVertices{0};
+	int32 FirstEdge{0};
+	int32 NumEdges{0};
+	/** Slice of the cluster pool, in the order of the clusters of the edge table */
+	int32 FirstCluster{0};
+	int32 NumClusters{0};
+	/** World bounds of all clusters */
+	FBox Bounds{ForceInit};
+};
+
+/** Hit of a world space ray with the triangles of the collected components */
+struct FMeshRayHit
+{
+	int32 OwnerIndex{INDEX_NONE};
+	/** Index of the triangle in the BVH of the owner */
+	int32 TriangleIndex{INDEX_NONE};
+	/** Distance along the ray */
+	double Distance{0.0};
+	FVector Position{FVector::ZeroVector};
+
+	bool IsValid() const
+	{
+		return OwnerIndex != INDEX_NONE;
+	}
+};
+
+/** World space edges of all collected components */
+struct FMeshEdgeWorldData
+{
+	TArray<FMeshEdgeOwner> Owners;
+	/** Vertex pool, each position relative to the origin of the owner it belongs to */
+	TArray<FVector3f> Positions;
+	/** World space normal of each vertex of the pool */
+	TArray<FVector3f> Normals;
+	/** Edges as pairs of vertex pool indices */
+	TArray<FMeshEdge> Edges;
+	/** Edge clusters of all owners, covering the edge pool in order */
+	TArray<FMeshEdgeWorldCluster> Clusters;
+
+	int32 NumEdges() const
+	{
+		return Edges.Num();
+	}
+
+	FVector GetWorldPosition(const FMeshEdgeOwner& Owner, uint32 VertexIndex) const
+	{
+		return Owner.Origin + FVector{Positions[VertexIndex]};
+	}
+
+	/** @return Index of the owner of the edge, found by binary search over the edge slices */
+	int32 FindOwnerOfEdge(int32 EdgeIndex) const
+	{
+		return Algo::UpperBoundBy(Owners, EdgeIndex, &FMeshEdgeOwner::FirstEdge) - 1;
+	}
+
+	/** @return Index of the owner of the pool vertex, found by binary search over the vertex slices */
+	int32 FindOwnerOfVertex(int32 VertexIndex) const
+	{
+		return Algo::UpperBoundBy(Owners, VertexIndex, &FMeshEdgeOwner::FirstVertex) - 1;
+	}
+
+	/**
+	* Finds the first triangle of the collected components hit by a ray
+	* @param Direction Normalized ray direction
+	*/
+	bool RayCast(const FVector& Origin, const FVector& Direction, double MaxDistance, FMeshRayHit& OutHit) const;
+
+	/**
+	* @return Index of the pool vertex closest to the ray, among those within Radius of it and at most MaxDistance
+	* along it
+	*/
+	int32 FindNearestVertexToRay(const FVector& Origin, const FVector& Direction, double MaxDistance,
+	                             double Radius) const;
+
+	/**
+	* @return Index of the edge closest to the ray, among those within Radius of it and at most MaxDistance along it
+	* @param OutAlpha Position of the closest point along the edge
+	*/
+	int32 FindNearestEdgeToRay(const FVector& Origin, const FVector& Direction, double MaxDistance, double Radius,
+	                           float& OutAlpha) const;
+
+	/**
+	* Finds the K pool vertices closest to a world position across all owners, nearest first. The vertex trees of the
+	* owners are built on first use.
+	* @param ExcludedVertex Pool vertex that is never returned, usually the one Position comes from
+	*/
+	void FindNearestVertices(const FVector& Position, int32 K, TArray<int32>& OutVertexIndices,
+	                         int32 ExcludedVertex = INDEX_NONE) const;
+
+private:
+	mutable FCriticalSection VertexTreeLock;
+};
+
+using FMeshEdgeWorldDataPtr = TSharedPtr<const FMeshEdgeWorldData, ESPMode::ThreadSafe>;
+using FMeshEdgeListPtr = TSharedPtr<const TArray<FMeshEdge>, ESPMode::ThreadSafe>;
+
+/** Edge found by FMeshEdgeSnapshot::FindNearestEdge */
+struct FMeshEdgePickResult
+{
+	int32 EdgeIndex{INDEX_NONE};
+	/** World space position of the closest point along the edge, 0 at its first and 1 at its second vertex */
+	float Alpha{0.f};
+	/** Screen distance from the query position to the edge */
+	float Distance{0.f};
+	/** Depth of the closest point */
+	float Depth{0.f};
+
+	bool IsValid() const
+	{
+		return EdgeIndex != INDEX_NONE;
+	}
+};
+
+/** Vertex found by FMeshEdgeSnapshot::FindNearestVertex */
+struct FMeshVertexPickResult
+{
+	/** Index into the vertex pool */
+	int32 VertexIndex{INDEX_NONE};
+	/** Screen distance from the query position to the vertex */
+	float Distance{0.f};
+	float Depth{0.f};
+
+	bool IsValid() const
+	{
+		return VertexIndex != INDEX_NONE;
+	}
+};
+
+/** Edges published by the collector */
+struct FMeshEdgeSnapshot
+{
+	/** World space stage, shared by consecutive snapshots until the geometry changes */
+	FMeshEdgeWorldDataPtr WorldData;
+	/**
+	* Screen space stage, one slot per vertex of the pool. Empty unless screen positions were requested, and only
+	* the vertices in VisibleVertexRuns are projected.
+	*/
+	FMeshDataIterators::FScreenSpacePositions ScreenPositions;
+	/** Pool vertices and edges of the clusters that survived culling against ScreenViewProjection */
+	TArray<FMeshIndexRun> VisibleVertexRuns;
+	TArray<FMeshIndexRun> VisibleEdgeRuns;
+	/** Projected edges and vertices binned by screen position, built along with ScreenPositions */
+	FMeshEdgeScreenGrid ScreenGrid;
+	/** View the screen positions were projected with */
+	FMeshDataIterators::FViewProjection ScreenViewProjection;
+	/**
+	* Silhouette and boundary edges seen from ScreenViewProjection as pairs of vertex pool indices, null unless
+	* silhouettes were requested. VisibleEdgeRuns then only covers these edges.
+	*/
+	FMeshEdgeListPtr SilhouetteEdges;
+
+	int32 NumEdges() const
+	{
+		return WorldData.IsValid() ? WorldData->NumEdges() : 0;
+	}
+
+	bool HasScreenPositions() const
+	{
+		return WorldData.IsValid() && WorldData->Positions.Num() > 0 &&
+			ScreenPositions.Num() == WorldData->Positions.Num();
+	}
+
+	/**
+	* Finds the edge closest to a screen position, in DPI independent pixels, among the edges within MaxDistance
+	* @param MaxDepth Edges whose closest point lies deeper are skipped, e.g. because they are occluded
+	*/
+	FMeshEdgePickResult FindNearestEdge(const FVector2D& ScreenPosition, float MaxDistance,
+	                                    float MaxDepth = BIG_NUMBER) const;
+
+	/** Finds the vertex closest to a screen position among the vertices within MaxDistance, see FindNearestEdge */
+	FMeshVertexPickResult FindNearestVertex(const FVector2D& ScreenPosition, float MaxDistance,
+	                                        float MaxDepth = BIG_NUMBER) const;
+};
+
+/** Input of one collection pass, gathered on the game thread */
+struct FMeshEdgeCollectRequest
+{
+	struct FComponentInput
+	{
+		TObjectKey<UPrimitiveComponent> ComponentKey;
+		AActor* Owner{nullptr};
+		const UStaticMesh* StaticMesh{nullptr};
+		/** Mesh of dynamic mesh components, used instead of StaticMesh when set */
+		FMeshSourceDataPtr MeshSource;
+		/** Pose of skinned mesh components, skinned by the pass and used instead of StaticMesh when set */
+		TOptional<FMeshSkinnedPose> SkinnedPose;
+		/** LOD of the static mesh the edges are taken from */
+		int32 LODIndex{0};
+		FTransform ComponentTransform;
+		/** The component moved or changed since the last pass */
+		bool bDirty{false};
+	};
+
+	TArray<FComponentInput> Components;
+	FMeshDataIterators::FViewProjection ViewProjection;
+	/** Run the world space stage over Components */
+	bool bCollectWorld{false};
+	/** Run the screen space stage with ViewProjection */
+	bool bProjectScreen{false};
+	/** Skip edge clusters facing away from the camera in the screen space stage */
+	bool bCullBackFaces{false};
+	/** Only keep the edges on the silhouette of the meshes in the screen space stage, along with boundary edges */
+	bool bSilhouettesOnly{false};
+	/** Edges collected by the world space stage */
+	FMeshEdgeFilter EdgeFilter;
+};
+
+/**
+ * Builds the edge overlay of the selected components in two stages. The world space stage caches positions per
+ * component and only recomputes them when the component is marked dirty or its mesh changes. The screen space stage
+ * reprojects the cached positions and never touches the mesh or the components. Passes must not run concurrently.
+ */
+class FMeshEdgeCollector
+{
+public:
+	/** World space stage, returns the new world data */
+	FMeshEdgeWorldDataPtr CollectWorldEdges(const FMeshEdgeCollectRequest& Request);
+
+	/**
+	* Screen space stage, culls the edge clusters of the last world space stage against the view frustum and
+	* projects the vertices of the visible ones
+	* @param bSilhouettesOnly Narrow the visible edges down to the silhouette edges, see FindSilhouetteEdges
+	*/
+	void ProjectEdges(const FMeshDataIterators::FViewProjection& ViewProjection, bool bCullBackFaces,
+	                  bool bSilhouettesOnly, FMeshEdgeSnapshot& OutSnapshot);
+
+	/** Runs the stages enabled in the request and fills the snapshot */
+	void Collect(const FMeshEdgeCollectRequest& Request, FMeshEdgeSnapshot& OutSnapshot);
+
+	/**
+	* Picks the LOD to collect the edges of a mesh from. Triangles are assumed to spread evenly over the projected
+	* bounds, the finest LOD whose edges then stay PixelThreshold pixels apart is returned.
+	* @param Bounds World bounds of the component
+	*/
+	static int32 SelectLOD(const UStaticMesh* StaticMesh, const FBoxSphereBounds& Bounds,
+	                       const FMeshDataIterators::FViewProjection& ViewProjection, float PixelThreshold);
+
+	void Reset();
+
+private:
+	struct FCollectedComponent
+	{
+		TObjectKey<UPrimitiveComponent> ComponentKey;
+		AActor* Owner{nullptr};
+		const UStaticMesh* StaticMesh{nullptr};
+		int32 LODIndex{0};
+		/** Source the uncached edge table and BVH below were built from */
+		FMeshSourceDataPtr MeshSource;
+		TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> EdgeTable;
+		/** Skinned pose of the edge table and the hash of the bone matrices it was skinned with */
+		FMeshEdgePosePtr Pose;
+		uint32 PoseHash{0};
+		TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> BVH;
+		FMeshEdgeSubsetPtr EdgeSubset;
+		FTransform ComponentTransform;
+		FMeshDataIterators::FWorldSpacePositions WorldPositions;
+		TArray<FVector3f> WorldNormals;
+		/** Clusters of the edge table in world space, updated along with WorldPositions */
+		TArray<FMeshEdgeWorldCluster> WorldClusters;
+	};
+
+	/** A slice of one component's vertices or edges and where it lands in the pool */
+	struct FElementRange
+	{
+		int32 ComponentIndex;
+		int32 First;
+		int32 Num;
+		int32 OutputOffset;
+	};
+
+	/** Splits the vertices and edges of the collected components into ranges */
+	void BuildRanges(FMeshEdgeWorldData& OutWorldData);
+
+	/** Collects the pool vertices and edges of the clusters visible from the view */
+	void CullClusters(const FMeshDataIterators::FViewProjection& ViewProjection, bool bCullBackFaces,
+	                  TArray<FMeshIndexRun>& OutVertexRuns, TArray<FMeshIndexRun>& OutEdgeRuns) const;
+
+	/**
+	* Keeps the pool edges of InOutEdgeRuns between a triangle facing the camera and one facing away, or with a
+	* single triangle. The faces are classified against the view in the local space of each component.
+	* @param OutEdges Kept edges as pairs of vertex pool indices, in pool order
+	*/
+	void FindSilhouetteEdges(const FMeshDataIterators::FViewProjection& ViewProjection,
+	                         TArray<FMeshIndexRun>& InOutEdgeRuns, TArray<FMeshEdge>& OutEdges) const;
+
+	/** Components of the last world space stage, in the order their edges were emitted */
+	TArray<FCollectedComponent> CollectedComponents;
+	TArray<FElementRange> VertexRanges;
+	TArray<FElementRange> EdgeRanges;
+	FMeshEdgeWorldDataPtr WorldData;
+	/** Filter the collected components were last filtered with */
+	FMeshEdgeFilter EdgeFilter;
+};
@@ -0,0 +1,215 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshEdgeScreenGrid.h"
+#include "MeshEditorStats.h"
+
+namespace
+{
+	/**
+	* Clips the segment to the box from zero to Max
+	* @return False if no part of the segment is inside the box
+	*/
+	bool ClipSegment(FVector2f& A, FVector2f& B, const FVector2f& Max)
+	{
+		const FVector2f Delta = B - A;
+		float MinT = 0.f;
+		float MaxT = 1.f;
+
+		// Keeps the part of the segment where Denominator * T <= Numerator
+		auto ClipSide = [&MinT, &MaxT](float Denominator, float Numerator)
+		{
+			if (Denominator == 0.f)
+			{
+				return Numerator >= 0.f;
+			}
+
+			const float T = Numerator / Denominator;
+			if (Denominator < 0.f)
+			{
+				MinT = FMath::Max(MinT, T);
+			}
+			else
+			{
+				MaxT = FMath::Min(MaxT, T);
+			}
+			return MinT <= MaxT;
+		};
+
+		if (!ClipSide(-Delta.X, A.X) || !ClipSide(Delta.X, Max.X - A.X) ||
+			!ClipSide(-Delta.Y, A.Y) || !ClipSide(Delta.Y, Max.Y - A.Y))
+		{
+			return false;
+		}
+
+		B = A + Delta * MaxT;
+		A = A + Delta * MinT;
+		return true;
+	}
+
+	/** Walks the cells crossed by a segment given in cell units, the segment must lie inside the grid */
+	template <typename FuncType>
+	void ForEachCellOnSegment(const FVector2f& A, const FVector2f& B, int32 NumCellsX, int32 NumCellsY,
+	                          FuncType&& Func)
+	{
+		int32 CellX = FMath::Clamp(FMath::FloorToInt(A.X), 0, NumCellsX - 1);
+		int32 CellY = FMath::Clamp(FMath::FloorToInt(A.Y), 0, NumCellsY - 1);
+		const int32 EndCellX = FMath::Clamp(FMath::FloorToInt(B.X), 0, NumCellsX - 1);
+		const int32 EndCellY = FMath::Clamp(FMath::FloorToInt(B.Y), 0, NumCellsY - 1);
+
+		const FVector2f Delta = B - A;
+		const int32 StepX = Delta.X > 0.f ? 1 : -1;
+		const int32 StepY = Delta.Y > 0.f ? 1 : -1;
+
+		// Segment parameter between two cell borders, and at the next border, along each axis
+		const float DeltaTX = Delta.X != 0.f ? FMath::Abs(1.f / Delta.X) : BIG_NUMBER;
+		const float DeltaTY = Delta.Y != 0.f ? FMath::Abs(1.f / Delta.Y) : BIG_NUMBER;
+		float NextTX = Delta.X != 0.f ? (StepX > 0 ? CellX + 1 - A.X : A.X - CellX) * DeltaTX : BIG_NUMBER;
+		float NextTY = Delta.Y != 0.f ? (StepY > 0 ? CellY + 1 - A.Y : A.Y - CellY) * DeltaTY : BIG_NUMBER;
+
+		Func(CellY * NumCellsX + CellX);
+		const int32 NumSteps = FMath::Abs(EndCellX - CellX) + FMath::Abs(EndCellY - CellY);
+		for (int32 Step = 0; Step < NumSteps; ++Step)
+		{
+			if (NextTX < NextTY)
+			{
+				CellX = FMath::Clamp(CellX + StepX, 0, NumCellsX - 1);
+				NextTX += DeltaTX;
+			}
+			else
+			{
+				CellY = FMath::Clamp(CellY + StepY, 0, NumCellsY - 1);
+				NextTY += DeltaTY;
+			}
+			Func(CellY * NumCellsX + CellX);
+		}
+	}
+
+	/** Turns per cell counts into start offsets and sizes the item array */
+	void AllocateCellItems(TArray<int32>& Starts, TArray<int32>& Items)
+	{
+		int32 NumItems = 0;
+		for (int32& Start : Starts)
+		{
+			const int32 NumCellItems = Start;
+			Start = NumItems;
+			NumItems += NumCellItems;
+		}
+		Items.SetNumUninitialized(NumItems, false);
+	}
+}
+
+void FMeshEdgeScreenGrid::Build(TConstArrayView<FMeshEdge> Edges,
+                                const FMeshDataIterators::FScreenSpacePositions& ScreenPositions,
+                                TConstArrayView<FMeshIndexRun> VertexRuns, TConstArrayView<FMeshIndexRun> EdgeRuns,
+                                const FBox2f& Bounds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MeshEditor_BuildScreenGrid);
+
+	Reset();
+	if (!Bounds.bIsValid)
+	{
+		return;
+	}
+
+	// One extra cell on every side keeps edges just outside of the view pickable
+	Origin = Bounds.Min - FVector2f(CellSize);
+	const FVector2f Size = Bounds.GetSize() + FVector2f(2.f * CellSize);
+	NumCellsX = FMath::Max(1, FMath::CeilToInt(Size.X / CellSize));
+	NumCellsY = FMath::Max(1, FMath::CeilToInt(Size.Y / CellSize));
+	const int32 NumCells = NumCellsX * NumCellsY;
+	const FVector2f GridSize{float(NumCellsX), float(NumCellsY)};
+
+	auto ToCellUnits = [this, &ScreenPositions](uint32 VertexIndex)
+	{
+		return FVector2f{
+			(ScreenPositions.X[VertexIndex] - Origin.X) / CellSize, (ScreenPositions.Y[VertexIndex] - Origin.Y) / CellSize
+		};
+	};
+
+	auto IsInFront = [&ScreenPositions](uint32 VertexIndex)
+	{
+		return ScreenPositions.Depth[VertexIndex] > 0.f;
+	};
+
+	// Vertices, counted first and then written to their cell. Cells are kept in run order for the second pass
+	TArray<TPair<int32, int32>> VertexCellIndices;
+	VertexCells.Starts.SetNumZeroed(NumCells + 1);
+	for (const FMeshIndexRun& Run : VertexRuns)
+	{
+		for (int32 VertexIndex = Run.First; VertexIndex < Run.First + Run.Num; ++VertexIndex)
+		{
+			const FVector2f Position = ToCellUnits(VertexIndex);
+			if (IsInFront(VertexIndex) && Position.X >= 0.f && Position.Y >= 0.f && Position.X < GridSize.X &&
+				Position.Y < GridSize.Y)
+			{
+				const int32 Cell = FMath::FloorToInt(Position.Y) * NumCellsX + FMath::FloorToInt(Position.X);
+				VertexCellIndices.Emplace(VertexIndex, Cell);
+				++VertexCells.Starts[Cell];
+			}
+		}
+	}
+	AllocateCellItems(VertexCells.Starts, VertexCells.Items);
+	for (const TPair<int32, int32>& VertexCell : VertexCellIndices)
+	{
+		VertexCells.Items[VertexCells.Starts[VertexCell.Value]++] = VertexCell.Key;
+	}
+
+	// Edges, walked once to count and once to write the cells they cross
+	auto ForEachEdgeCell = [&](auto&& Func)
+	{
+		for (const FMeshIndexRun& Run : EdgeRuns)
+		{
+			for (int32 EdgeIndex = Run.First; EdgeIndex < Run.First + Run.Num; ++EdgeIndex)
+			{
+				const FMeshEdge& Edge = Edges[EdgeIndex];
+				if (!IsInFront(Edge.FirstIndex) || !IsInFront(Edge.SecondIndex))
+				{
+					continue;
+				}
+
+				FVector2f First = ToCellUnits(Edge.FirstIndex);
+				FVector2f Second = ToCellUnits(Edge.SecondIndex);
+				if (ClipSegment(First, Second, GridSize))
+				{
+					ForEachCellOnSegment(First, Second, NumCellsX, NumCellsY, [&Func, EdgeIndex](int32 Cell)
+					{
+						Func(Cell, EdgeIndex);
+					});
+				}
+			}
+		}
+	};
+
+	EdgeCells.Starts.SetNumZeroed(NumCells + 1);
+	ForEachEdgeCell([this](int32 Cell, int32 EdgeIndex)
+	{
+		++EdgeCells.Starts[Cell];
+	});
+	AllocateCellItems(EdgeCells.Starts, EdgeCells.Items);
+	ForEachEdgeCell([this](int32 Cell, int32 EdgeIndex)
+	{
+		EdgeCells.Items[EdgeCells.Starts[Cell]++] = EdgeIndex;
+	});
+
+	// Writing advanced every start to the end of its cell, shift them back by one cell
+	for (FCellItems* Cells : {&VertexCells, &EdgeCells})
+	{
+		for (int32 Cell = NumCells; Cell > 0; --Cell)
+		{
+			Cells->Starts[Cell] = Cells->Starts[Cell - 1];
+		}
+		Cells->Starts[0] = 0;
+	}
+}
+
+void FMeshEdgeScreenGrid::Reset()
+{
+	Origin = FVector2f::ZeroVector;
+	NumCellsX = 0;
+	NumCellsY = 0;
+	EdgeCells.Starts.Reset();
+	EdgeCells.Items.Reset();
+	VertexCells.Starts.Reset();
+	VertexCells.Items.Reset();
+}
@@ -0,0 +1,98 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Helper/MeshDataIterators.h"
+#include "Helper/MeshEdgeTable.h"
+
+/**
+ * Uniform grid over the projected edges and vertices of a snapshot. Every cell lists the edges crossing it and the
+ * vertices inside it, so that screen space queries only look at the few cells around the query position.
+ */
+class FMeshEdgeScreenGrid
+{
+public:
+	/** Side of a cell in DPI independent pixels */
+	static constexpr float CellSize = 32.f;
+
+	/**
+	* Bins the edges and vertices that are in front of the camera and overlap Bounds
+	* @param Edges Pairs of indices into ScreenPositions
+	* @param VertexRuns Vertices to bin, only their screen positions are read
+	* @param EdgeRuns Edges to bin, their vertices must be part of VertexRuns
+	*/
+	void Build(TConstArrayView<FMeshEdge> Edges, const FMeshDataIterators::FScreenSpacePositions& ScreenPositions,
+	           TConstArrayView<FMeshIndexRun> VertexRuns, TConstArrayView<FMeshIndexRun> EdgeRuns,
+	           const FBox2f& Bounds);
+
+	void Reset();
+
+	bool IsEmpty() const
+	{
+		return NumCellsX == 0 || NumCellsY == 0;
+	}
+
+	/**
+	* Calls Visitor with the index of every edge crossing a cell within Radius of Position. Edges spanning several of
+	* those cells are visited once per cell.
+	*/
+	template <typename VisitorType>
+	void ForEachEdge(const FVector2f& Position, float Radius, VisitorType&& Visitor) const
+	{
+		ForEachItem(EdgeCells, Position, Radius, Forward<VisitorType>(Visitor));
+	}
+
+	/** Calls Visitor with the index of every vertex in a cell within Radius of Position */
+	template <typename VisitorType>
+	void ForEachVertex(const FVector2f& Position, float Radius, VisitorType&& Visitor) const
+	{
+		ForEachItem(VertexCells, Position, Radius, Forward<VisitorType>(Visitor));
+	}
+
+private:
+	/** Items of all cells packed together, the items of cell C are Items[Starts[C]] to Items[Starts[C + 1] - 1] */
+	struct FCellItems
+	{
+		TArray<int32> Starts;
+		TArray<int32> Items;
+	};
+
+	template <typename VisitorType>
+	void ForEachItem(const FCellItems& Cells, const FVector2f& Position, float Radius, VisitorType&& Visitor) const
+	{
+		if (IsEmpty())
+		{
+			return;
+		}
+
+		const FIntPoint MinCell = GetCell(Position - FVector2f(Radius));
+		const FIntPoint MaxCell = GetCell(Position + FVector2f(Radius));
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+		{
+			for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+			{
+				const int32 Cell = CellY * NumCellsX + CellX;
+				for (int32 ItemIndex = Cells.Starts[Cell]; ItemIndex < Cells.Starts[Cell + 1]; ++ItemIndex)
+				{
+					Visitor(Cells.Items[ItemIndex]);
+				}
+			}
+		}
+	}
+
+	/** @return The cell containing Position, clamped to the grid */
+	FIntPoint GetCell(const FVector2f& Position) const
+	{
+		return FIntPoint{
+			FMath::Clamp(FMath::FloorToInt((Position.X - Origin.X) / CellSize), 0, NumCellsX - 1),
+			FMath::Clamp(FMath::FloorToInt((Position.Y - Origin.Y) / CellSize), 0, NumCellsY - 1)
+		};
+	}
+
+	FVector2f Origin{FVector2f::ZeroVector};
+	int32 NumCellsX{0};
+	int32 NumCellsY{0};
+	FCellItems EdgeCells;
+	FCellItems VertexCells;
+};
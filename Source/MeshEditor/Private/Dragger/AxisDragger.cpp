@@ -1,4 +1,5 @@
 ﻿#include "AxisDragger.h"
+#include "MeshEditorStats.h"
 #include "Materials/MaterialInstanceDynamic.h"
 
 
@@ -118,6 +119,7 @@ void FAxisDragger::RenderAxis(FPrimitiveDrawInterface* PDI, const FSceneView* Vi
 	const FVector Offset(0, 0, HalfHeight);
 
 	PDI->SetHitProxy(new HAxisDraggerProxy(InAxis, bFlipped));
+	INC_DWORD_STAT(STAT_MeshEditor_HitProxies);
 	UMaterialInstanceDynamic* InMaterial = AxisMaterial;
 	if (InAxis == CurrentAxisType && bFlipped == CurrentAxisFlipped)
 	{
@@ -0,0 +1,295 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshBVH.h"
+#include "MeshDataIterators.h"
+#include "MeshDerivedData.h"
+#include "MeshEditorStats.h"
+#include "MeshLODCache.h"
+#include "Algo/Sort.h"
+
+namespace
+{
+	/** Nodes with this many triangles or less are not split further */
+	constexpr int32 MaxLeafTriangles = 4;
+
+	TMeshLODCache<FMeshBVH>& GetBVHCache()
+	{
+		static TMeshLODCache<FMeshBVH> BVHCache;
+		return BVHCache;
+	}
+
+	/** Two sided ray triangle intersection, OutT is the distance along the ray in multiples of Direction */
+	bool IntersectTriangle(const FVector3f& Origin, const FVector3f& Direction, const FVector3f& A,
+	                       const FVector3f& B, const FVector3f& C, float& OutT)
+	{
+		const FVector3f AB = B - A;
+		const FVector3f AC = C - A;
+		const FVector3f P = FVector3f::CrossProduct(Direction, AC);
+		const float Determinant = FVector3f::DotProduct(AB, P);
+		if (FMath::Abs(Determinant) <= SMALL_NUMBER)
+		{
+			return false;
+		}
+
+		const float InvDeterminant = 1.f / Determinant;
+		const FVector3f S = Origin - A;
+		const float U = FVector3f::DotProduct(S, P) * InvDeterminant;
+		if (U < 0.f || U > 1.f)
+		{
+			return false;
+		}
+
+		const FVector3f Q = FVector3f::CrossProduct(S, AB);
+		const float V = FVector3f::DotProduct(Direction, Q) * InvDeterminant;
+		if (V < 0.f || U + V > 1.f)
+		{
+			return false;
+		}
+
+		OutT = FVector3f::DotProduct(AC, Q) * InvDeterminant;
+		return OutT >= 0.f;
+	}
+}
+
+TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> FMeshBVH::FindOrBuild(const UStaticMesh* StaticMesh, int32 LODIndex)
+{
+	return GetBVHCache().FindOrBuild(StaticMesh, LODIndex,
+	                                 [StaticMesh, LODIndex](const FStaticMeshRenderData& RenderData,
+	                                                        const FStaticMeshLODResources& LODResources)
+	                                 {
+		                                 const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> EdgeTable =
+			                                 FMeshEdgeTable::FindOrBuild(StaticMesh, LODIndex);
+		                                 const FString Version = FString::Printf(
+			                                 TEXT("%s_%s"), DerivedDataVersion, FMeshEdgeTable::DerivedDataVersion);
+		                                 return FMeshDerivedData::LoadOrBuild<FMeshBVH>(
+			                                 StaticMesh, RenderData, LODIndex, TEXT("BVH"), *Version,
+			                                 [&EdgeTable]
+			                                 {
+				                                 TSharedPtr<FMeshBVH, ESPMode::ThreadSafe> BVH =
+					                                 MakeShared<FMeshBVH, ESPMode::ThreadSafe>();
+				                                 BVH->EdgeTable = EdgeTable;
+				                                 return BVH;
+			                                 },
+			                                 [&LODResources, &EdgeTable] { return Build(LODResources, EdgeTable); });
+	                                 });
+}
+
+void FMeshBVH::Serialize(FArchive& Ar)
+{
+	FMeshDerivedData::SerializeArray(Ar, Triangles);
+	FMeshDerivedData::SerializeArray(Ar, TriangleEdges);
+	FMeshDerivedData::SerializeArray(Ar, Nodes);
+}
+
+void FMeshBVH::RemoveUnusedBVHs()
+{
+	GetBVHCache().RemoveUnused();
+}
+
+template <typename MeshType>
+TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> FMeshBVH::BuildBVH(
+	const MeshType& Mesh,
+	const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable)
+{
+	if (!EdgeTable.IsValid())
+	{
+		return nullptr;
+	}
+
+	TSharedPtr<FMeshBVH, ESPMode::ThreadSafe> BVH = MakeShared<FMeshBVH, ESPMode::ThreadSafe>();
+	BVH->EdgeTable = EdgeTable;
+
+	TMap<uint64, int32> EdgeIndexByKey;
+	EdgeIndexByKey.Reserve(EdgeTable->NumEdges());
+	for (int32 EdgeIndex = 0; EdgeIndex < EdgeTable->NumEdges(); ++EdgeIndex)
+	{
+		const FMeshEdge& Edge = EdgeTable->Edges[EdgeIndex];
+		EdgeIndexByKey.Add(FMeshEdgeTable::MakeEdgeKey(Edge.FirstIndex, Edge.SecondIndex), EdgeIndex);
+	}
+
+	// Welded triangles, skipping those that collapsed to a line or a point
+	TArray<FIntVector> Triangles;
+	TArray<FIntVector> TriangleEdges;
+	TArray<FVector3f> Centroids;
+	Triangles.Reserve(FMeshDataIterators::TMeshSourceTraits<MeshType>::NumIndices(Mesh) / 3);
+	FMeshDataIterators::ForEachTriangle(Mesh, [&](int32, uint32 A, uint32 B, uint32 C)
+	{
+		const FIntVector Triangle{
+			int32(EdgeTable->WeldedVertexIndices[A]),
+			int32(EdgeTable->WeldedVertexIndices[B]),
+			int32(EdgeTable->WeldedVertexIndices[C])
+		};
+		if (Triangle.X == Triangle.Y || Triangle.Y == Triangle.Z || Triangle.Z == Triangle.X)
+		{
+			return;
+		}
+
+		Triangles.Add(Triangle);
+		TriangleEdges.Add(FIntVector{
+			EdgeIndexByKey.FindChecked(FMeshEdgeTable::MakeEdgeKey(Triangle.X, Triangle.Y)),
+			EdgeIndexByKey.FindChecked(FMeshEdgeTable::MakeEdgeKey(Triangle.Y, Triangle.Z)),
+			EdgeIndexByKey.FindChecked(FMeshEdgeTable::MakeEdgeKey(Triangle.Z, Triangle.X))
+		});
+		Centroids.Add((EdgeTable->Positions[Triangle.X] + EdgeTable->Positions[Triangle.Y] +
+			EdgeTable->Positions[Triangle.Z]) / 3.f);
+	});
+
+	if (Triangles.Num() == 0)
+	{
+		return BVH;
+	}
+
+	// Split nodes at the median centroid along their longest axis, Order holds the triangles in leaf order
+	TArray<int32> Order;
+	Order.SetNumUninitialized(Triangles.Num());
+	for (int32 Index = 0; Index < Order.Num(); ++Index)
+	{
+		Order[Index] = Index;
+	}
+
+	BVH->Nodes.Add(FNode{FBox3f(ForceInit), 0, Triangles.Num()});
+	TArray<int32> NodeStack{0};
+	while (NodeStack.Num() > 0)
+	{
+		const int32 NodeIndex = NodeStack.Pop(false);
+		const int32 First = BVH->Nodes[NodeIndex].FirstIndex;
+		const int32 Num = BVH->Nodes[NodeIndex].NumTriangles;
+
+		FBox3f Bounds(ForceInit);
+		FBox3f CentroidBounds(ForceInit);
+		for (int32 Index = First; Index < First + Num; ++Index)
+		{
+			const FIntVector& Triangle = Triangles[Order[Index]];
+			Bounds += EdgeTable->Positions[Triangle.X];
+			Bounds += EdgeTable->Positions[Triangle.Y];
+			Bounds += EdgeTable->Positions[Triangle.Z];
+			CentroidBounds += Centroids[Order[Index]];
+		}
+		BVH->Nodes[NodeIndex].Bounds = Bounds;
+
+		const FVector3f Extent = CentroidBounds.GetExtent();
+		const int32 Axis = Extent.X >= Extent.Y && Extent.X >= Extent.Z ? 0 : (Extent.Y >= Extent.Z ? 1 : 2);
+		if (Num <= MaxLeafTriangles || Extent[Axis] <= 0.f)
+		{
+			continue;
+		}
+
+		Algo::SortBy(MakeArrayView(Order.GetData() + First, Num), [&Centroids, Axis](int32 TriangleIndex)
+		{
+			return Centroids[TriangleIndex][Axis];
+		});
+
+		const int32 NumLeft = Num / 2;
+		const int32 LeftIndex = BVH->Nodes.Add(FNode{FBox3f(ForceInit), First, NumLeft});
+		BVH->Nodes.Add(FNode{FBox3f(ForceInit), First + NumLeft, Num - NumLeft});
+		BVH->Nodes[NodeIndex].FirstIndex = LeftIndex;
+		BVH->Nodes[NodeIndex].NumTriangles = 0;
+		NodeStack.Push(LeftIndex);
+		NodeStack.Push(LeftIndex + 1);
+	}
+
+	BVH->Triangles.Reserve(Order.Num());
+	BVH->TriangleEdges.Reserve(Order.Num());
+	for (const int32 TriangleIndex : Order)
+	{
+		BVH->Triangles.Add(Triangles[TriangleIndex]);
+		BVH->TriangleEdges.Add(TriangleEdges[TriangleIndex]);
+	}
+	BVH->Nodes.Shrink();
+
+	return BVH;
+}
+
+TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> FMeshBVH::Build(
+	const FStaticMeshLODResources& LODResources,
+	const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMeshBVH::Build);
+	return BuildBVH(LODResources, EdgeTable);
+}
+
+TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> FMeshBVH::Build(
+	const FMeshSourceData& MeshSource,
+	const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMeshBVH::Build);
+	return BuildBVH(MeshSource, EdgeTable);
+}
+
+TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> FMeshBVH::Refit(const FMeshEdgePosePtr& InPose) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMeshBVH::Refit);
+
+	TSharedPtr<FMeshBVH, ESPMode::ThreadSafe> BVH = MakeShared<FMeshBVH, ESPMode::ThreadSafe>(*this);
+	BVH->Pose = InPose;
+	const TArray<FVector3f>& Positions = BVH->GetPositions();
+
+	// Children are always added after their parent, walking backwards sees both of them before it
+	for (int32 NodeIndex = BVH->Nodes.Num() - 1; NodeIndex >= 0; --NodeIndex)
+	{
+		FNode& Node = BVH->Nodes[NodeIndex];
+		if (Node.IsLeaf())
+		{
+			Node.Bounds = FBox3f(ForceInit);
+			for (int32 Index = Node.FirstIndex; Index < Node.FirstIndex + Node.NumTriangles; ++Index)
+			{
+				const FIntVector& Triangle = BVH->Triangles[Index];
+				Node.Bounds += Positions[Triangle.X];
+				Node.Bounds += Positions[Triangle.Y];
+				Node.Bounds += Positions[Triangle.Z];
+			}
+		}
+		else
+		{
+			Node.Bounds = BVH->Nodes[Node.FirstIndex].Bounds + BVH->Nodes[Node.FirstIndex + 1].Bounds;
+		}
+	}
+	return BVH;
+}
+
+bool FMeshBVH::RayCast(const FVector3f& Origin, const FVector3f& Direction, float MaxT, float& OutT,
+                       int32& OutTriangleIndex) const
+{
+	OutTriangleIndex = INDEX_NONE;
+	OutT = MaxT;
+	if (Nodes.Num() == 0)
+	{
+		return false;
+	}
+
+	const TArray<FVector3f>& Positions = GetPositions();
+	const FVector3f InvDirection = GetInvDirection(Direction);
+	TArray<int32, TInlineAllocator<64>> NodeStack{0};
+	while (NodeStack.Num() > 0)
+	{
+		const FNode& Node = Nodes[NodeStack.Pop(false)];
+		float EntryT;
+		if (!IntersectBox(Node.Bounds, Origin, InvDirection, OutT, EntryT))
+		{
+			continue;
+		}
+
+		if (Node.IsLeaf())
+		{
+			for (int32 Index = Node.FirstIndex; Index < Node.FirstIndex + Node.NumTriangles; ++Index)
+			{
+				const FIntVector& Triangle = Triangles[Index];
+				float T;
+				if (IntersectTriangle(Origin, Direction, Positions[Triangle.X], Positions[Triangle.Y],
+				                      Positions[Triangle.Z], T) &&
+					T < OutT)
+				{
+					OutT = T;
+					OutTriangleIndex = Index;
+				}
+			}
+		}
+		else
+		{
+			NodeStack.Push(Node.FirstIndex);
+			NodeStack.Push(Node.FirstIndex + 1);
+		}
+	}
+	return OutTriangleIndex != INDEX_NONE;
+}
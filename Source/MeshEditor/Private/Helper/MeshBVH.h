@@ -0,0 +1,171 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Helper/MeshEdgeTable.h"
+
+class UStaticMesh;
+struct FStaticMeshLODResources;
+struct FMeshSourceData;
+
+/**
+ * Bounding volume hierarchy over the triangles of one static mesh LOD or FMeshSourceData, in mesh local space.
+ * Triangles refer to the welded vertices of the edge table, so query results map directly to edge table vertices and
+ * edges.
+ */
+class FMeshBVH
+{
+public:
+	/**
+	* @return The shared BVH of the mesh LOD, built on first use and cached until the render data changes
+	*/
+	static TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> FindOrBuild(const UStaticMesh* StaticMesh, int32 LODIndex);
+
+	/**
+	* Changes whenever the layout or the build of BVHs changes, so BVHs in the derived data cache are rebuilt. Cached
+	* BVHs are also keyed on FMeshEdgeTable::DerivedDataVersion since they refer to edge table vertices and edges.
+	*/
+	static constexpr const TCHAR* DerivedDataVersion = TEXT("B2E97F4C0A3D4F5B8E61C7D92A0F3B14");
+
+	/** Releases cached BVHs of meshes that no longer exist or that nothing references anymore */
+	static void RemoveUnusedBVHs();
+
+	static TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> Build(
+		const FStaticMeshLODResources& LODResources,
+		const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable);
+
+	/** Builds an uncached BVH, for meshes that are not static meshes. EdgeTable must be built from the same source. */
+	static TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> Build(
+		const FMeshSourceData& MeshSource,
+		const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable);
+
+	/**
+	* @return A BVH over the same triangles whose bounds are refit to a pose of the edge table, e.g. a skinned pose.
+	* Its queries run against the posed positions. The split layout stays that of this BVH, which holds up as long as
+	* the pose does not move triangles far from their neighbors.
+	*/
+	TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> Refit(const FMeshEdgePosePtr& Pose) const;
+
+	/**
+	* Finds the first triangle hit by a ray. Direction does not need to be normalized, distances along the ray are
+	* measured in multiples of it.
+	* @return True if a triangle is hit before MaxT
+	*/
+	bool RayCast(const FVector3f& Origin, const FVector3f& Direction, float MaxT, float& OutT,
+	             int32& OutTriangleIndex) const;
+
+	/** Calls Visitor with every triangle whose bounds, grown by Radius, are crossed by the ray before MaxT */
+	template <typename VisitorType>
+	void ForEachTriangleNearRay(const FVector3f& Origin, const FVector3f& Direction, float MaxT, float Radius,
+	                            VisitorType&& Visitor) const
+	{
+		if (Nodes.Num() == 0)
+		{
+			return;
+		}
+
+		const FVector3f InvDirection = GetInvDirection(Direction);
+		TArray<int32, TInlineAllocator<64>> NodeStack{0};
+		while (NodeStack.Num() > 0)
+		{
+			const FNode& Node = Nodes[NodeStack.Pop(false)];
+			float EntryT;
+			if (!IntersectBox(Node.Bounds.ExpandBy(Radius), Origin, InvDirection, MaxT, EntryT))
+			{
+				continue;
+			}
+
+			if (Node.IsLeaf())
+			{
+				for (int32 Index = Node.FirstIndex; Index < Node.FirstIndex + Node.NumTriangles; ++Index)
+				{
+					Visitor(Index);
+				}
+			}
+			else
+			{
+				NodeStack.Push(Node.FirstIndex);
+				NodeStack.Push(Node.FirstIndex + 1);
+			}
+		}
+	}
+
+	const FMeshEdgeTable& GetEdgeTable() const
+	{
+		return *EdgeTable;
+	}
+
+	int32 NumTriangles() const
+	{
+		return Triangles.Num();
+	}
+
+	/** Edge table vertices of the triangle */
+	const FIntVector& GetTriangleVertices(int32 TriangleIndex) const
+	{
+		return Triangles[TriangleIndex];
+	}
+
+	/** Edge table edges of the triangle, the edge at side K joins vertices K and K + 1 */
+	const FIntVector& GetTriangleEdges(int32 TriangleIndex) const
+	{
+		return TriangleEdges[TriangleIndex];
+	}
+
+	/** Reads or writes the BVH for the derived data cache, the edge table is not part of it */
+	void Serialize(FArchive& Ar);
+
+private:
+	template <typename MeshType>
+	static TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> BuildBVH(
+		const MeshType& Mesh,
+		const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable);
+
+	struct FNode
+	{
+		FBox3f Bounds{ForceInit};
+		/** First triangle of a leaf, or first of the two consecutive children of an inner node */
+		int32 FirstIndex{0};
+		int32 NumTriangles{0};
+
+		bool IsLeaf() const
+		{
+			return NumTriangles > 0;
+		}
+	};
+
+	static FVector3f GetInvDirection(const FVector3f& Direction)
+	{
+		return FVector3f{
+			Direction.X != 0.f ? 1.f / Direction.X : BIG_NUMBER,
+			Direction.Y != 0.f ? 1.f / Direction.Y : BIG_NUMBER,
+			Direction.Z != 0.f ? 1.f / Direction.Z : BIG_NUMBER
+		};
+	}
+
+	/** Vertex positions the triangles are placed at */
+	const TArray<FVector3f>& GetPositions() const
+	{
+		return Pose.IsValid() ? Pose->Positions : EdgeTable->Positions;
+	}
+
+	/** Slab test, OutEntryT is where the ray enters the box */
+	static bool IntersectBox(const FBox3f& Box, const FVector3f& Origin, const FVector3f& InvDirection, float MaxT,
+	                         float& OutEntryT)
+	{
+		const FVector3f T0 = (Box.Min - Origin) * InvDirection;
+		const FVector3f T1 = (Box.Max - Origin) * InvDirection;
+		OutEntryT = FMath::Max3(FMath::Min(T0.X, T1.X), FMath::Min(T0.Y, T1.Y), FMath::Min(T0.Z, T1.Z));
+		const float ExitT = FMath::Min3(FMath::Max(T0.X, T1.X), FMath::Max(T0.Y, T1.Y), FMath::Max(T0.Z, T1.Z));
+		return OutEntryT <= ExitT && ExitT >= 0.f && OutEntryT <= MaxT;
+	}
+
+	TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> EdgeTable;
+	/** Pose the bounds were refit to, null for the pose of the edge table */
+	FMeshEdgePosePtr Pose;
+	/** Triangles in leaf order, degenerate triangles are left out */
+	TArray<FIntVector> Triangles;
+	TArray<FIntVector> TriangleEdges;
+	TArray<FNode> Nodes;
+};
@@ -2,14 +2,30 @@
 
 
 #include "MeshDataIterators.h"
+#include "MeshEditorStats.h"
+#include "Math/VectorRegister.h"
+#include "RHI.h"
+#include "SceneView.h"
+#include "StaticMeshResources.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
 
 namespace FMeshDataIterators
 {
-	FStaticMeshVertexIterator::FStaticMeshVertexIterator(UStaticMeshComponent* SMC)
+	namespace
+	{
+		FStaticMeshLODResources& GetLODResources(UStaticMeshComponent* SMC, int32 LODIndex)
+		{
+			TIndirectArray<FStaticMeshLODResources>& LODResources = SMC->GetStaticMesh()->GetRenderData()->LODResources;
+			return LODResources[FMath::Clamp(LODIndex, 0, LODResources.Num() - 1)];
+		}
+	}
+
+	FStaticMeshVertexIterator::FStaticMeshVertexIterator(UStaticMeshComponent* SMC, int32 LODIndex)
 	: ComponentToWorldIT(SMC->GetComponentTransform().ToInverseMatrixWithScale().GetTransposed())
 	  , StaticMeshComponent(SMC)
-	, PositionBuffer(SMC->GetStaticMesh()->GetRenderData()->LODResources[0].VertexBuffers.PositionVertexBuffer)
-	, VertexBuffer(SMC->GetStaticMesh()->GetRenderData()->LODResources[0].VertexBuffers.StaticMeshVertexBuffer),
+	, PositionBuffer(GetLODResources(SMC, LODIndex).VertexBuffers.PositionVertexBuffer)
+	, VertexBuffer(GetLODResources(SMC, LODIndex).VertexBuffers.StaticMeshVertexBuffer),
 	  CurrentVertexIndex(0)
 	{
 	}
@@ -35,11 +51,11 @@ namespace FMeshDataIterators
 		return CurrentVertexIndex < PositionBuffer.GetNumVertices();
 	}
 	
-	FStaticMeshEdgeIterator::FStaticMeshEdgeIterator(UStaticMeshComponent* SMC)
+	FStaticMeshEdgeIterator::FStaticMeshEdgeIterator(UStaticMeshComponent* SMC, int32 LODIndex)
 		: ComponentToWorldIT(SMC->GetComponentTransform().ToInverseMatrixWithScale().GetTransposed())
 		  , StaticMeshComponent(SMC)
-		  , PositionBuffer(SMC->GetStaticMesh()->GetRenderData()->LODResources[0].VertexBuffers.PositionVertexBuffer)
-		  , IndexBuffer(SMC->GetStaticMesh()->GetRenderData()->LODResources[0].IndexBuffer)
+		  , PositionBuffer(GetLODResources(SMC, LODIndex).VertexBuffers.PositionVertexBuffer)
+		  , IndexBuffer(GetLODResources(SMC, LODIndex).IndexBuffer)
 		  , CurrentEdgeIndex(0)
 		  , CurrentTriangeVertexIndex(0), MaxEdgeIndex(0)
 	{
@@ -83,24 +99,489 @@ namespace FMeshDataIterators
 		return IndexBuffer.GetArrayView()[(CurrentTriangeVertexIndex + 1) % 3 + CurrentEdgeIndex * 3];
 	}
 
-	TSharedPtr<FVertexIterator> MakeVertexIterator(UPrimitiveComponent* Component)
+	FMeshSourceVertexIterator::FMeshSourceVertexIterator(const FMeshSourceDataPtr& InMeshSource,
+	                                                     const FTransform& InComponentToWorld)
+		: MeshSource(InMeshSource)
+		  , ComponentToWorld(InComponentToWorld)
+		  , ComponentToWorldIT(InComponentToWorld.ToInverseMatrixWithScale().GetTransposed())
+		  , CurrentVertexIndex(0)
+	{
+	}
+
+	FVector FMeshSourceVertexIterator::Position() const
+	{
+		return ComponentToWorld.TransformPosition(FVector(MeshSource->Positions[CurrentVertexIndex]));
+	}
+
+	FVector FMeshSourceVertexIterator::Normal() const
+	{
+		return ComponentToWorldIT.TransformVector(FVector(MeshSource->Normals[CurrentVertexIndex]));
+	}
+
+	void FMeshSourceVertexIterator::Advance()
+	{
+		++CurrentVertexIndex;
+	}
+
+	bool FMeshSourceVertexIterator::HasMoreVertices() const
+	{
+		return CurrentVertexIndex < MeshSource->Positions.Num();
+	}
+
+	FMeshSourceEdgeIterator::FMeshSourceEdgeIterator(const FMeshSourceDataPtr& InMeshSource,
+	                                                 const FTransform& InComponentToWorld)
+		: MeshSource(InMeshSource)
+		  , ComponentToWorld(InComponentToWorld)
+		  , CurrentTriangleCorner(0)
+		  , CurrentSide(0)
+	{
+	}
+
+	void FMeshSourceEdgeIterator::Advance()
+	{
+		CurrentSide = (CurrentSide + 1) % 3;
+		if (CurrentSide == 0)
+		{
+			CurrentTriangleCorner += 3;
+		}
+	}
+
+	bool FMeshSourceEdgeIterator::HasMoreEdges() const
+	{
+		return CurrentTriangleCorner + 2 < MeshSource->Indices.Num();
+	}
+
+	FVector FMeshSourceEdgeIterator::FirstEndpoint() const
+	{
+		return ComponentToWorld.TransformPosition(FVector(MeshSource->Positions[FirstEndpointIndex()]));
+	}
+
+	FVector FMeshSourceEdgeIterator::SecondEndpoint() const
+	{
+		return ComponentToWorld.TransformPosition(FVector(MeshSource->Positions[SecondEndpointIndex()]));
+	}
+
+	int32 FMeshSourceEdgeIterator::FirstEndpointIndex() const
+	{
+		return MeshSource->Indices[CurrentTriangleCorner + CurrentSide];
+	}
+
+	int32 FMeshSourceEdgeIterator::SecondEndpointIndex() const
+	{
+		return MeshSource->Indices[CurrentTriangleCorner + (CurrentSide + 1) % 3];
+	}
+
+	namespace
+	{
+		/** Linear part of LocalToWorld, rows are the scaled local axes */
+		FMatrix44f GetRelativeTransformMatrix(const FTransform& LocalToWorld)
+		{
+			FMatrix LinearPart = LocalToWorld.ToMatrixWithScale();
+			LinearPart.SetOrigin(FVector::ZeroVector);
+			return FMatrix44f(LinearPart);
+		}
+
+		void TransformPositionsScalarRange(const FMatrix44f& M, const FVector3f* Src, int32 Begin, int32 End,
+		                                   FWorldSpacePositions& OutPositions)
+		{
+			for (int32 Index = Begin; Index < End; ++Index)
+			{
+				const FVector3f& P = Src[Index];
+				OutPositions.X[Index] = P.X * M.M[0][0] + P.Y * M.M[1][0] + P.Z * M.M[2][0];
+				OutPositions.Y[Index] = P.X * M.M[0][1] + P.Y * M.M[1][1] + P.Z * M.M[2][1];
+				OutPositions.Z[Index] = P.X * M.M[0][2] + P.Y * M.M[1][2] + P.Z * M.M[2][2];
+			}
+		}
+	}
+
+	void TransformPositions(const FTransform& LocalToWorld, TConstArrayView<FVector3f> LocalPositions,
+	                        FWorldSpacePositions& OutPositions)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FMeshDataIterators::TransformPositions);
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS
+		const int32 NumPositions = LocalPositions.Num();
+		OutPositions.Origin = LocalToWorld.GetTranslation();
+		OutPositions.SetNum(NumPositions);
+
+		const FMatrix44f M = GetRelativeTransformMatrix(LocalToWorld);
+		const VectorRegister4Float M00 = VectorSetFloat1(M.M[0][0]);
+		const VectorRegister4Float M01 = VectorSetFloat1(M.M[0][1]);
+		const VectorRegister4Float M02 = VectorSetFloat1(M.M[0][2]);
+		const VectorRegister4Float M10 = VectorSetFloat1(M.M[1][0]);
+		const VectorRegister4Float M11 = VectorSetFloat1(M.M[1][1]);
+		const VectorRegister4Float M12 = VectorSetFloat1(M.M[1][2]);
+		const VectorRegister4Float M20 = VectorSetFloat1(M.M[2][0]);
+		const VectorRegister4Float M21 = VectorSetFloat1(M.M[2][1]);
+		const VectorRegister4Float M22 = VectorSetFloat1(M.M[2][2]);
+
+		const FVector3f* Src = LocalPositions.GetData();
+		float* OutX = OutPositions.X.GetData();
+		float* OutY = OutPositions.Y.GetData();
+		float* OutZ = OutPositions.Z.GetData();
+
+		// Gather four vertices into X, Y and Z lanes and transform them together
+		const int32 NumVectorized = NumPositions & ~3;
+		for (int32 Index = 0; Index < NumVectorized; Index += 4)
+		{
+			const FVector3f* P = Src + Index;
+			const VectorRegister4Float PX = MakeVectorRegisterFloat(P[0].X, P[1].X, P[2].X, P[3].X);
+			const VectorRegister4Float PY = MakeVectorRegisterFloat(P[0].Y, P[1].Y, P[2].Y, P[3].Y);
+			const VectorRegister4Float PZ = MakeVectorRegisterFloat(P[0].Z, P[1].Z, P[2].Z, P[3].Z);
+
+			VectorStore(VectorMultiplyAdd(PZ, M20, VectorMultiplyAdd(PY, M10, VectorMultiply(PX, M00))), OutX + Index);
+			VectorStore(VectorMultiplyAdd(PZ, M21, VectorMultiplyAdd(PY, M11, VectorMultiply(PX, M01))), OutY + Index);
+			VectorStore(VectorMultiplyAdd(PZ, M22, VectorMultiplyAdd(PY, M12, VectorMultiply(PX, M02))), OutZ + Index);
+		}
+
+		TransformPositionsScalarRange(M, Src, NumVectorized, NumPositions, OutPositions);
+#else
+		TransformPositionsScalar(LocalToWorld, LocalPositions, OutPositions);
+#endif
+	}
+
+	void TransformPositions(const FTransform& LocalToWorld, const FPositionVertexBuffer& PositionBuffer,
+	                        FWorldSpacePositions& OutPositions)
+	{
+		const int32 NumVertices = PositionBuffer.GetNumVertices();
+		TransformPositions(LocalToWorld,
+		                   NumVertices > 0
+			                   ? TConstArrayView<FVector3f>(&PositionBuffer.VertexPosition(0), NumVertices)
+			                   : TConstArrayView<FVector3f>(),
+		                   OutPositions);
+	}
+
+	void TransformPositionsScalar(const FTransform& LocalToWorld, TConstArrayView<FVector3f> LocalPositions,
+	                              FWorldSpacePositions& OutPositions)
+	{
+		OutPositions.Origin = LocalToWorld.GetTranslation();
+		OutPositions.SetNum(LocalPositions.Num());
+		TransformPositionsScalarRange(GetRelativeTransformMatrix(LocalToWorld), LocalPositions.GetData(), 0,
+		                              LocalPositions.Num(), OutPositions);
+	}
+
+	void TransformNormals(const FTransform& LocalToWorld, TConstArrayView<FVector3f> LocalNormals,
+	                      TArray<FVector3f>& OutNormals)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FMeshDataIterators::TransformNormals);
+
+		const FMatrix44f LocalToWorldIT(LocalToWorld.ToInverseMatrixWithScale().GetTransposed());
+		OutNormals.SetNumUninitialized(LocalNormals.Num(), false);
+		for (int32 Index = 0; Index < LocalNormals.Num(); ++Index)
+		{
+			OutNormals[Index] = LocalToWorldIT.TransformVector(LocalNormals[Index]).GetSafeNormal();
+		}
+	}
+
+	namespace
+	{
+		void ComputeFrontFacingScalarRange(const FFacePlanes& Planes, const FVector3f& LocalEye, float EyeW,
+		                                   int32 Begin, int32 End, uint8* OutFrontFacing)
+		{
+			for (int32 Index = Begin; Index < End; ++Index)
+			{
+				const float Side = Planes.NX[Index] * LocalEye.X + Planes.NY[Index] * LocalEye.Y +
+					Planes.NZ[Index] * LocalEye.Z - Planes.W[Index] * EyeW;
+				OutFrontFacing[Index] = Side > 0.f ? 1 : 0;
+			}
+		}
+	}
+
+	void ComputeFrontFacing(const FFacePlanes& Planes, const FVector3f& LocalEye, bool bIsPerspective,
+	                        TArray<uint8>& OutFrontFacing)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FMeshDataIterators::ComputeFrontFacing);
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS
+		const int32 NumFaces = Planes.Num();
+		OutFrontFacing.SetNumUninitialized(NumFaces, false);
+
+		// A direction is a point at infinity, the plane offset does not matter for it
+		const float EyeW = bIsPerspective ? 1.f : 0.f;
+		const VectorRegister4Float EyeX = VectorSetFloat1(LocalEye.X);
+		const VectorRegister4Float EyeY = VectorSetFloat1(LocalEye.Y);
+		const VectorRegister4Float EyeZ = VectorSetFloat1(LocalEye.Z);
+		const VectorRegister4Float NegEyeW = VectorSetFloat1(-EyeW);
+		uint8* Out = OutFrontFacing.GetData();
+
+		const int32 NumVectorized = NumFaces & ~3;
+		for (int32 Index = 0; Index < NumVectorized; Index += 4)
+		{
+			const VectorRegister4Float Side = VectorMultiplyAdd(
+				VectorLoad(Planes.NZ.GetData() + Index), EyeZ, VectorMultiplyAdd(
+					VectorLoad(Planes.NY.GetData() + Index), EyeY, VectorMultiplyAdd(
+						VectorLoad(Planes.NX.GetData() + Index), EyeX,
+						VectorMultiply(VectorLoad(Planes.W.GetData() + Index), NegEyeW))));
+			const uint32 FrontMask = VectorMaskBits(VectorCompareGT(Side, VectorZeroFloat()));
+			Out[Index] = FrontMask & 1;
+			Out[Index + 1] = (FrontMask >> 1) & 1;
+			Out[Index + 2] = (FrontMask >> 2) & 1;
+			Out[Index + 3] = (FrontMask >> 3) & 1;
+		}
+
+		ComputeFrontFacingScalarRange(Planes, LocalEye, EyeW, NumVectorized, NumFaces, Out);
+#else
+		ComputeFrontFacingScalar(Planes, LocalEye, bIsPerspective, OutFrontFacing);
+#endif
+	}
+
+	void ComputeFrontFacingScalar(const FFacePlanes& Planes, const FVector3f& LocalEye, bool bIsPerspective,
+	                              TArray<uint8>& OutFrontFacing)
+	{
+		OutFrontFacing.SetNumUninitialized(Planes.Num(), false);
+		ComputeFrontFacingScalarRange(Planes, LocalEye, bIsPerspective ? 1.f : 0.f, 0, Planes.Num(),
+		                              OutFrontFacing.GetData());
+	}
+
+	FViewProjection::FViewProjection(const FSceneView& View, float InDPIScale)
+		: ViewProjectionMatrix(View.ViewMatrices.GetViewProjectionMatrix())
+		  , ViewRect(View.UnscaledViewRect)
+		  , DPIScale(InDPIScale)
+		  , bFlipY(GProjectionSignY <= 0.0f)
+		  , ViewOrigin(View.ViewMatrices.GetViewOrigin())
+		  , ViewDirection(View.GetViewDirection())
+		  , bIsPerspective(View.IsPerspectiveProjection())
+		  , ViewKey(View.GetViewKey())
+	{
+	}
+
+	FVector2D FViewProjection::WorldToScreen(const FVector& WorldPosition) const
+	{
+		const FVector4 ClipPosition = ViewProjectionMatrix.TransformFVector4(FVector4(WorldPosition, 1.0));
+		const double InvW = 1.0 / FMath::Max(FMath::Abs(ClipPosition.W), double(SMALL_NUMBER));
+		const double ClipY = bFlipY ? 1.0 - ClipPosition.Y : ClipPosition.Y;
+		return FVector2D{
+			(ViewRect.Min.X + (0.5 + ClipPosition.X * 0.5 * InvW) * ViewRect.Width()) / DPIScale,
+			(ViewRect.Min.Y + (0.5 - ClipY * 0.5 * InvW) * ViewRect.Height()) / DPIScale
+		};
+	}
+
+	double FViewProjection::GetDepth(const FVector& WorldPosition) const
+	{
+		return ViewProjectionMatrix.TransformFVector4(FVector4(WorldPosition, 1.0)).W;
+	}
+
+	double FViewProjection::GetScreenRadius(const FVector& Center, double Radius) const
+	{
+		const double Depth = GetDepth(Center);
+		if (bIsPerspective && Depth <= Radius)
+		{
+			return BIG_NUMBER;
+		}
+
+		// The view rotation keeps the length of the clip X axis, which is the horizontal projection scale
+		const double ProjectionScale = FVector{
+			ViewProjectionMatrix.M[0][0], ViewProjectionMatrix.M[1][0], ViewProjectionMatrix.M[2][0]
+		}.Size();
+		return Radius * ProjectionScale * 0.5 * ViewRect.Width() / (FMath::Max(Depth, double(SMALL_NUMBER)) * DPIScale);
+	}
+
+	namespace
+	{
+		/** Screen mapping folded into Screen = Offset + Clip / |W| * Scale, with Y scale negated */
+		struct FClipToScreen
+		{
+			explicit FClipToScreen(const FViewProjection& View)
+			{
+				const float HalfWidth = 0.5f * View.ViewRect.Width();
+				const float HalfHeight = 0.5f * View.ViewRect.Height();
+				OffsetX = (View.ViewRect.Min.X + HalfWidth) / View.DPIScale;
+				OffsetY = (View.ViewRect.Min.Y + HalfHeight) / View.DPIScale;
+				ScaleX = HalfWidth / View.DPIScale;
+				ScaleY = -HalfHeight / View.DPIScale;
+			}
+
+			float OffsetX;
+			float OffsetY;
+			float ScaleX;
+			float ScaleY;
+		};
+
+		FMatrix44f GetRelativeViewProjectionMatrix(const FViewProjection& View, const FVector& Origin)
+		{
+			return FMatrix44f(FTranslationMatrix(Origin) * View.ViewProjectionMatrix);
+		}
+
+		void ProjectPositionsScalarRange(const FViewProjection& View, const FMatrix44f& M,
+		                                 const FWorldSpacePositions& Positions, int32 Begin, int32 End,
+		                                 FScreenSpacePositions& OutScreenPositions, int32 OutFirst)
+		{
+			const FClipToScreen ClipToScreen(View);
+			for (int32 Index = Begin, OutIndex = OutFirst; Index < End; ++Index, ++OutIndex)
+			{
+				const float PX = Positions.X[Index];
+				const float PY = Positions.Y[Index];
+				const float PZ = Positions.Z[Index];
+				const float ClipX = PX * M.M[0][0] + PY * M.M[1][0] + PZ * M.M[2][0] + M.M[3][0];
+				float ClipY = PX * M.M[0][1] + PY * M.M[1][1] + PZ * M.M[2][1] + M.M[3][1];
+				const float ClipW = PX * M.M[0][3] + PY * M.M[1][3] + PZ * M.M[2][3] + M.M[3][3];
+				const float InvW = 1.0f / FMath::Max(FMath::Abs(ClipW), SMALL_NUMBER);
+				ClipY = View.bFlipY ? 1.0f - ClipY : ClipY;
+
+				OutScreenPositions.X[OutIndex] = ClipToScreen.OffsetX + ClipX * InvW * ClipToScreen.ScaleX;
+				OutScreenPositions.Y[OutIndex] = ClipToScreen.OffsetY + ClipY * InvW * ClipToScreen.ScaleY;
+				OutScreenPositions.Depth[OutIndex] = ClipW;
+			}
+		}
+	}
+
+	void ProjectPositions(const FViewProjection& View, const FWorldSpacePositions& Positions,
+	                      FScreenSpacePositions& OutScreenPositions)
+	{
+		OutScreenPositions.SetNum(Positions.Num());
+		ProjectPositions(View, Positions, 0, Positions.Num(), OutScreenPositions, 0);
+	}
+
+	void ProjectPositions(const FViewProjection& View, const FWorldSpacePositions& Positions, int32 Begin, int32 End,
+	                      FScreenSpacePositions& OutScreenPositions, int32 OutFirst)
+	{
+		check(OutFirst + (End - Begin) <= OutScreenPositions.Num());
+#if PLATFORM_ENABLE_VECTORINTRINSICS
+		const FMatrix44f M = GetRelativeViewProjectionMatrix(View, Positions.Origin);
+		const VectorRegister4Float M00 = VectorSetFloat1(M.M[0][0]);
+		const VectorRegister4Float M01 = VectorSetFloat1(M.M[0][1]);
+		const VectorRegister4Float M03 = VectorSetFloat1(M.M[0][3]);
+		const VectorRegister4Float M10 = VectorSetFloat1(M.M[1][0]);
+		const VectorRegister4Float M11 = VectorSetFloat1(M.M[1][1]);
+		const VectorRegister4Float M13 = VectorSetFloat1(M.M[1][3]);
+		const VectorRegister4Float M20 = VectorSetFloat1(M.M[2][0]);
+		const VectorRegister4Float M21 = VectorSetFloat1(M.M[2][1]);
+		const VectorRegister4Float M23 = VectorSetFloat1(M.M[2][3]);
+		const VectorRegister4Float M30 = VectorSetFloat1(M.M[3][0]);
+		const VectorRegister4Float M31 = VectorSetFloat1(M.M[3][1]);
+		const VectorRegister4Float M33 = VectorSetFloat1(M.M[3][3]);
+
+		const FClipToScreen ClipToScreen(View);
+		const VectorRegister4Float OffsetX = VectorSetFloat1(ClipToScreen.OffsetX);
+		const VectorRegister4Float OffsetY = VectorSetFloat1(ClipToScreen.OffsetY);
+		const VectorRegister4Float ScaleX = VectorSetFloat1(ClipToScreen.ScaleX);
+		const VectorRegister4Float ScaleY = VectorSetFloat1(ClipToScreen.ScaleY);
+		const VectorRegister4Float MinW = VectorSetFloat1(SMALL_NUMBER);
+		const VectorRegister4Float One = VectorOne();
+
+		// Both sides are offset so that the loop indexes them the same way
+		const float* SrcX = Positions.X.GetData() + Begin;
+		const float* SrcY = Positions.Y.GetData() + Begin;
+		const float* SrcZ = Positions.Z.GetData() + Begin;
+		float* OutX = OutScreenPositions.X.GetData() + OutFirst;
+		float* OutY = OutScreenPositions.Y.GetData() + OutFirst;
+		float* OutDepth = OutScreenPositions.Depth.GetData() + OutFirst;
+
+		const int32 NumPositions = End - Begin;
+		const int32 NumVectorized = NumPositions & ~3;
+		for (int32 Index = 0; Index < NumVectorized; Index += 4)
+		{
+			const VectorRegister4Float PX = VectorLoad(SrcX + Index);
+			const VectorRegister4Float PY = VectorLoad(SrcY + Index);
+			const VectorRegister4Float PZ = VectorLoad(SrcZ + Index);
+
+			const VectorRegister4Float ClipX =
+				VectorMultiplyAdd(PZ, M20, VectorMultiplyAdd(PY, M10, VectorMultiplyAdd(PX, M00, M30)));
+			VectorRegister4Float ClipY =
+				VectorMultiplyAdd(PZ, M21, VectorMultiplyAdd(PY, M11, VectorMultiplyAdd(PX, M01, M31)));
+			const VectorRegister4Float ClipW =
+				VectorMultiplyAdd(PZ, M23, VectorMultiplyAdd(PY, M13, VectorMultiplyAdd(PX, M03, M33)));
+
+			const VectorRegister4Float InvW = VectorDivide(One, VectorMax(VectorAbs(ClipW), MinW));
+			if (View.bFlipY)
+			{
+				ClipY = VectorSubtract(One, ClipY);
+			}
+
+			VectorStore(VectorMultiplyAdd(VectorMultiply(ClipX, InvW), ScaleX, OffsetX), OutX + Index);
+			VectorStore(VectorMultiplyAdd(VectorMultiply(ClipY, InvW), ScaleY, OffsetY), OutY + Index);
+			VectorStore(ClipW, OutDepth + Index);
+		}
+
+		ProjectPositionsScalarRange(View, M, Positions, Begin + NumVectorized, End, OutScreenPositions,
+		                            OutFirst + NumVectorized);
+#else
+		ProjectPositionsScalarRange(View, GetRelativeViewProjectionMatrix(View, Positions.Origin), Positions, Begin,
+		                            End, OutScreenPositions, OutFirst);
+#endif
+	}
+
+	void ProjectPositionsScalar(const FViewProjection& View, const FWorldSpacePositions& Positions,
+	                            FScreenSpacePositions& OutScreenPositions)
+	{
+		OutScreenPositions.SetNum(Positions.Num());
+		ProjectPositionsScalarRange(View, GetRelativeViewProjectionMatrix(View, Positions.Origin), Positions, 0,
+		                            Positions.Num(), OutScreenPositions, 0);
+	}
+
+	TSharedPtr<FVertexIterator> MakeVertexIterator(UPrimitiveComponent* Component, int32 LODIndex)
 	{
 		UStaticMeshComponent* SMC = Cast<UStaticMeshComponent>(Component);
-		if (SMC && SMC->GetStaticMesh())
+		if (SMC && SMC->GetStaticMesh() && SMC->GetStaticMesh()->HasValidRenderData())
 		{
-			return MakeShareable(new FStaticMeshVertexIterator(SMC));
+			return MakeShareable(new FStaticMeshVertexIterator(SMC, LODIndex));
+		}
+		if (const FMeshSourceDataPtr MeshSource = FMeshSources::FindOrExtract(Component, LODIndex))
+		{
+			return MakeShareable(new FMeshSourceVertexIterator(MeshSource, Component->GetComponentTransform()));
 		}
 		return nullptr;
 	}
 	
-	TSharedPtr<FEdgeIterator> MakeEdgeIterator(UPrimitiveComponent* Component)
+	TSharedPtr<FEdgeIterator> MakeEdgeIterator(UPrimitiveComponent* Component, int32 LODIndex)
 	{
 		UStaticMeshComponent* SMC = Cast<UStaticMeshComponent>(Component);
-		if (SMC && SMC->GetStaticMesh())
+		if (SMC && SMC->GetStaticMesh() && SMC->GetStaticMesh()->HasValidRenderData())
+		{
+			return MakeShareable(new FStaticMeshEdgeIterator(SMC, LODIndex));
+		}
+		if (const FMeshSourceDataPtr MeshSource = FMeshSources::FindOrExtract(Component, LODIndex))
 		{
-			return MakeShareable(new FStaticMeshEdgeIterator(SMC));
+			return MakeShareable(new FMeshSourceEdgeIterator(MeshSource, Component->GetComponentTransform()));
 		}
 
 		return nullptr;
 	}
+
+	int32 GetRenderedLOD(const UStaticMeshComponent* Component, const FViewProjection& View)
+	{
+		const UStaticMesh* StaticMesh = Component ? Component->GetStaticMesh() : nullptr;
+		const FStaticMeshRenderData* RenderData = StaticMesh ? StaticMesh->GetRenderData() : nullptr;
+		if (!RenderData || RenderData->LODResources.Num() == 0)
+		{
+			return 0;
+		}
+
+		const int32 NumLODs = RenderData->LODResources.Num();
+		int32 MinLOD = RenderData->CurrentFirstLODIdx;
+		if (Component->bOverrideMinLOD)
+		{
+			MinLOD = FMath::Max(MinLOD, Component->MinLOD);
+		}
+		MinLOD = FMath::Clamp(MinLOD, 0, NumLODs - 1);
+
+		if (Component->ForcedLodModel > 0)
+		{
+			return FMath::Clamp(Component->ForcedLodModel - 1, MinLOD, NumLODs - 1);
+		}
+
+		// Same walk as ComputeStaticMeshLOD, with the screen radius measured as a fraction of the view width
+		const double ScreenWidth = FMath::Max(View.ViewRect.Width() / View.DPIScale, 1.f);
+		const double ScreenRadius = View.GetScreenRadius(Component->Bounds.Origin, Component->Bounds.SphereRadius) /
+			ScreenWidth;
+		for (int32 LODIndex = NumLODs - 1; LODIndex >= 0; --LODIndex)
+		{
+			if (RenderData->ScreenSize[LODIndex].GetValue() * 0.5 > ScreenRadius)
+			{
+				return FMath::Max(LODIndex, MinLOD);
+			}
+		}
+		return MinLOD;
+	}
+
+	const FStaticMeshLODResources* FindLODResources(const UStaticMeshComponent* Component, int32 LODIndex)
+	{
+		const UStaticMesh* StaticMesh = Component ? Component->GetStaticMesh() : nullptr;
+		const FStaticMeshRenderData* RenderData = StaticMesh ? StaticMesh->GetRenderData() : nullptr;
+		if (!RenderData || RenderData->LODResources.Num() == 0)
+		{
+			return nullptr;
+		}
+		return &RenderData->LODResources[FMath::Clamp(LODIndex, 0, RenderData->LODResources.Num() - 1)];
+	}
 }
@@ -4,8 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "UObject/Object.h"
+#include "Rendering/PositionVertexBuffer.h"
+#include "StaticMeshResources.h"
+#include "Helper/MeshSource.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 // #include "MeshDataIterators.generated.h"
 
+class FSceneView;
+
 namespace FMeshDataIterators
 {
 	class FVertexIterator
@@ -101,7 +107,8 @@ namespace FMeshDataIterators
 	class FStaticMeshVertexIterator : public FVertexIterator
 	{
 	public:
-		FStaticMeshVertexIterator(UStaticMeshComponent* SMC);
+		/** @param LODIndex Mesh LOD to read, clamped to the LODs the mesh has */
+		FStaticMeshVertexIterator(UStaticMeshComponent* SMC, int32 LODIndex = 0);
 
 		/** FVertexIterator interface */
 		virtual FVector Position() const override;
@@ -127,7 +134,8 @@ namespace FMeshDataIterators
 	class FStaticMeshEdgeIterator : public FEdgeIterator
 	{
 	public:
-		FStaticMeshEdgeIterator(UStaticMeshComponent* SMC);
+		/** @param LODIndex Mesh LOD to read, clamped to the LODs the mesh has */
+		FStaticMeshEdgeIterator(UStaticMeshComponent* SMC, int32 LODIndex = 0);
 
 		virtual FVector FirstEndpoint() const override;
 
@@ -159,12 +167,460 @@ namespace FMeshDataIterators
 	};
 
 	/**
-	* Makes a vertex iterator from the specified component
+	* Vertices of a skinned or dynamic mesh component, read from the FMeshSourceData taken when the iterator was made
+	*/
+	class FMeshSourceVertexIterator : public FVertexIterator
+	{
+	public:
+		FMeshSourceVertexIterator(const FMeshSourceDataPtr& InMeshSource, const FTransform& InComponentToWorld);
+
+		/** FVertexIterator interface */
+		virtual FVector Position() const override;
+		virtual FVector Normal() const override;
+
+	protected:
+		virtual void Advance() override;
+		virtual bool HasMoreVertices() const override;
+
+	private:
+		/** Keeps the extracted mesh alive while iterating */
+		FMeshSourceDataPtr MeshSource;
+		FTransform ComponentToWorld;
+		/** Component To World Inverse Transpose matrix */
+		FMatrix ComponentToWorldIT;
+		/** Current vertex index */
+		int32 CurrentVertexIndex;
+	};
+
+	/**
+	* Triangle sides of a skinned or dynamic mesh component, in the same order as FStaticMeshEdgeIterator
+	*/
+	class FMeshSourceEdgeIterator : public FEdgeIterator
+	{
+	public:
+		FMeshSourceEdgeIterator(const FMeshSourceDataPtr& InMeshSource, const FTransform& InComponentToWorld);
+
+		virtual FVector FirstEndpoint() const override;
+
+		virtual FVector SecondEndpoint() const override;
+
+		virtual int32 FirstEndpointIndex() const override;
+
+		virtual int32 SecondEndpointIndex() const override;
+
+	protected:
+		virtual void Advance() override;
+		virtual bool HasMoreEdges() const override;
+
+	private:
+		/** Keeps the extracted mesh alive while iterating */
+		FMeshSourceDataPtr MeshSource;
+		FTransform ComponentToWorld;
+		/** Index of the first corner of the current triangle */
+		int32 CurrentTriangleCorner;
+		/** Side of the current triangle, 0 to 2 */
+		int32 CurrentSide;
+	};
+
+	/**
+	* World space positions stored as separate X, Y and Z streams. Coordinates are kept in single precision relative
+	* to Origin so that large world coordinates do not lose precision.
+	*/
+	struct FWorldSpacePositions
+	{
+		FVector Origin{FVector::ZeroVector};
+		TArray<float> X;
+		TArray<float> Y;
+		TArray<float> Z;
+
+		int32 Num() const
+		{
+			return X.Num();
+		}
+
+		FVector3f GetRelativePosition(int32 Index) const
+		{
+			return FVector3f{X[Index], Y[Index], Z[Index]};
+		}
+
+		FVector GetPosition(int32 Index) const
+		{
+			return Origin + FVector{X[Index], Y[Index], Z[Index]};
+		}
+
+		void SetNum(int32 NewNum)
+		{
+			X.SetNumUninitialized(NewNum, false);
+			Y.SetNumUninitialized(NewNum, false);
+			Z.SetNumUninitialized(NewNum, false);
+		}
+	};
+
+	/**
+	* Transforms local positions to world space in one pass, four vertices at a time when vector intrinsics are
+	* available. The result is relative to the translation of LocalToWorld.
+	*/
+	void TransformPositions(const FTransform& LocalToWorld, TConstArrayView<FVector3f> LocalPositions,
+	                        FWorldSpacePositions& OutPositions);
+
+	/**
+	* Transforms every vertex of the position buffer to world space
+	*/
+	void TransformPositions(const FTransform& LocalToWorld, const FPositionVertexBuffer& PositionBuffer,
+	                        FWorldSpacePositions& OutPositions);
+
+	/**
+	* Reference implementation of TransformPositions without vector intrinsics
+	*/
+	void TransformPositionsScalar(const FTransform& LocalToWorld, TConstArrayView<FVector3f> LocalPositions,
+	                              FWorldSpacePositions& OutPositions);
+
+	/**
+	* Transforms local normals to world space with the inverse transpose of LocalToWorld and renormalizes them
+	*/
+	void TransformNormals(const FTransform& LocalToWorld, TConstArrayView<FVector3f> LocalNormals,
+	                      TArray<FVector3f>& OutNormals);
+
+	/**
+	* Triangle planes stored as separate streams. Points P on face I satisfy N.P = W[I], with N the unit normal
+	* (NX[I], NY[I], NZ[I]). Degenerate faces have a zero normal.
+	*/
+	struct FFacePlanes
+	{
+		TArray<float> NX;
+		TArray<float> NY;
+		TArray<float> NZ;
+		TArray<float> W;
+
+		int32 Num() const
+		{
+			return NX.Num();
+		}
+
+		FVector3f GetNormal(int32 Index) const
+		{
+			return FVector3f{NX[Index], NY[Index], NZ[Index]};
+		}
+
+		void SetNum(int32 NewNum)
+		{
+			NX.SetNumUninitialized(NewNum, false);
+			NY.SetNumUninitialized(NewNum, false);
+			NZ.SetNumUninitialized(NewNum, false);
+			W.SetNumUninitialized(NewNum, false);
+		}
+
+		void Set(int32 Index, const FVector3f& Normal, float Distance)
+		{
+			NX[Index] = Normal.X;
+			NY[Index] = Normal.Y;
+			NZ[Index] = Normal.Z;
+			W[Index] = Distance;
+		}
+	};
+
+	/**
+	* Finds the faces whose front side the camera sees, four faces at a time when vector intrinsics are available.
+	* OutFrontFacing is one for those faces and zero for the others, degenerate faces included.
+	* @param LocalEye Camera position in the space of the planes, or the direction towards the camera for
+	* orthographic views
+	*/
+	void ComputeFrontFacing(const FFacePlanes& Planes, const FVector3f& LocalEye, bool bIsPerspective,
+	                        TArray<uint8>& OutFrontFacing);
+
+	/**
+	* Reference implementation of ComputeFrontFacing without vector intrinsics
+	*/
+	void ComputeFrontFacingScalar(const FFacePlanes& Planes, const FVector3f& LocalEye, bool bIsPerspective,
+	                              TArray<uint8>& OutFrontFacing);
+
+	/**
+	* Screen positions stored as separate X and Y streams, in DPI independent viewport pixels, along with their depth
 	*/
-	static TSharedPtr<FVertexIterator> MakeVertexIterator(UPrimitiveComponent* Component);
+	struct FScreenSpacePositions
+	{
+		TArray<float> X;
+		TArray<float> Y;
+		/** Clip space W, the view depth for perspective views. Not positive for positions behind the camera */
+		TArray<float> Depth;
+
+		int32 Num() const
+		{
+			return X.Num();
+		}
+
+		FVector2D GetPosition(int32 Index) const
+		{
+			return FVector2D{X[Index], Y[Index]};
+		}
+
+		void SetNum(int32 NewNum)
+		{
+			X.SetNumUninitialized(NewNum, false);
+			Y.SetNumUninitialized(NewNum, false);
+			Depth.SetNumUninitialized(NewNum, false);
+		}
+	};
+
+	/**
+	* Copy of the view state needed to project world positions to the screen. Unlike the FSceneView it is taken
+	* from, it can be kept across frames and used on any thread.
+	*/
+	struct FViewProjection
+	{
+		FViewProjection() = default;
+		FViewProjection(const FSceneView& View, float InDPIScale);
+
+		/** Same result as FSceneView::WorldToPixel divided by the DPI scale */
+		FVector2D WorldToScreen(const FVector& WorldPosition) const;
+
+		/** @return Depth of the position as stored in FScreenSpacePositions */
+		double GetDepth(const FVector& WorldPosition) const;
+
+		/** @return Radius in DPI independent pixels of a sphere on screen, BIG_NUMBER if the camera is inside it */
+		double GetScreenRadius(const FVector& Center, double Radius) const;
+
+		/** @return True if both snapshots project every position to the same pixel */
+		bool Equals(const FViewProjection& Other) const
+		{
+			return ViewProjectionMatrix == Other.ViewProjectionMatrix && ViewRect == Other.ViewRect &&
+				DPIScale == Other.DPIScale && bFlipY == Other.bFlipY;
+		}
+
+		FMatrix ViewProjectionMatrix{FMatrix::Identity};
+		FIntRect ViewRect{};
+		float DPIScale{1.f};
+		bool bFlipY{false};
+		/** Camera placement, implied by ViewProjectionMatrix and kept for culling */
+		FVector ViewOrigin{FVector::ZeroVector};
+		FVector ViewDirection{FVector::ForwardVector};
+		bool bIsPerspective{true};
+		/** FSceneView::GetViewKey, tells the viewports apart. Equals ignores it. */
+		uint32 ViewKey{0};
+	};
+
+	/**
+	* Projects world positions to the screen in one pass, four vertices at a time when vector intrinsics are
+	* available. The view projection is rebased on the positions origin so the whole pass runs in single precision.
+	*/
+	void ProjectPositions(const FViewProjection& View, const FWorldSpacePositions& Positions,
+	                      FScreenSpacePositions& OutScreenPositions);
+
+	/**
+	* Projects the positions from Begin to End - 1 only, writing them from OutFirst on. OutScreenPositions must
+	* already be large enough.
+	*/
+	void ProjectPositions(const FViewProjection& View, const FWorldSpacePositions& Positions, int32 Begin, int32 End,
+	                      FScreenSpacePositions& OutScreenPositions, int32 OutFirst);
+
+	/**
+	* Reference implementation of ProjectPositions without vector intrinsics
+	*/
+	void ProjectPositionsScalar(const FViewProjection& View, const FWorldSpacePositions& Positions,
+	                            FScreenSpacePositions& OutScreenPositions);
+
+	/**
+	* Makes a vertex iterator over one LOD of the specified component. Skinned meshes are read in their current pose.
+	*/
+	TSharedPtr<FVertexIterator> MakeVertexIterator(UPrimitiveComponent* Component, int32 LODIndex = 0);
 	
 	/**
-	* Makes a edge iterator from the specified component
+	* Makes a edge iterator over one LOD of the specified component. Skinned meshes are read in their current pose.
+	*/
+	TSharedPtr<FEdgeIterator> MakeEdgeIterator(UPrimitiveComponent* Component, int32 LODIndex = 0);
+
+	/**
+	* @return The LOD the renderer draws the component with in the view, following the same screen size rules as
+	* the static mesh scene proxy
 	*/
-	static TSharedPtr<FEdgeIterator> MakeEdgeIterator(UPrimitiveComponent* Component);
+	int32 GetRenderedLOD(const UStaticMeshComponent* Component, const FViewProjection& View);
+
+	/**
+	* @return The render data of one LOD of the component, clamped to the LODs the mesh has, or null when the
+	* component has no mesh to read
+	*/
+	const FStaticMeshLODResources* FindLODResources(const UStaticMeshComponent* Component, int32 LODIndex);
+
+	/**
+	* Compile time access to the vertices and indices of a mesh source. VisitIndices hands the whole index buffer
+	* to the callable as a view of its stored width, so the 16 or 32 bit branch is taken once per mesh instead of
+	* once per index.
+	*/
+	template <typename MeshType>
+	struct TMeshSourceTraits;
+
+	template <>
+	struct TMeshSourceTraits<FStaticMeshLODResources>
+	{
+		static int32 NumVertices(const FStaticMeshLODResources& Mesh)
+		{
+			return Mesh.VertexBuffers.PositionVertexBuffer.GetNumVertices();
+		}
+
+		static const FVector3f& GetPosition(const FStaticMeshLODResources& Mesh, uint32 VertexIndex)
+		{
+			return Mesh.VertexBuffers.PositionVertexBuffer.VertexPosition(VertexIndex);
+		}
+
+		static FVector3f GetNormal(const FStaticMeshLODResources& Mesh, uint32 VertexIndex)
+		{
+			return Mesh.VertexBuffers.StaticMeshVertexBuffer.VertexTangentZ(VertexIndex);
+		}
+
+		/** @return The first UV channel of the vertex, zero if the mesh has none */
+		static FVector2f GetUV(const FStaticMeshLODResources& Mesh, uint32 VertexIndex)
+		{
+			const FStaticMeshVertexBuffer& VertexBuffer = Mesh.VertexBuffers.StaticMeshVertexBuffer;
+			return VertexBuffer.GetNumTexCoords() > 0
+				       ? VertexBuffer.GetVertexUV(VertexIndex, 0)
+				       : FVector2f::ZeroVector;
+		}
+
+		/** Calls Visitor(FirstTriangle, NumTriangles, MaterialIndex) for every section */
+		template <typename VisitorType>
+		static void ForEachSection(const FStaticMeshLODResources& Mesh, VisitorType&& Visitor)
+		{
+			for (const FStaticMeshSection& Section : Mesh.Sections)
+			{
+				Visitor(int32(Section.FirstIndex / 3), int32(Section.NumTriangles), Section.MaterialIndex);
+			}
+		}
+
+		static int32 NumIndices(const FStaticMeshLODResources& Mesh)
+		{
+			return Mesh.IndexBuffer.GetNumIndices();
+		}
+
+		template <typename CallableType>
+		static void VisitIndices(const FStaticMeshLODResources& Mesh, CallableType&& Callable)
+		{
+			const FRawStaticIndexBuffer& IndexBuffer = Mesh.IndexBuffer;
+			const int32 NumIndices = IndexBuffer.GetNumIndices();
+			if (NumIndices == 0)
+			{
+				return;
+			}
+
+			if (IndexBuffer.Is32Bit())
+			{
+				Callable(TConstArrayView<uint32>(IndexBuffer.AccessStream32(), NumIndices));
+			}
+			else
+			{
+				Callable(TConstArrayView<uint16>(IndexBuffer.AccessStream16(), NumIndices));
+			}
+		}
+	};
+
+	template <>
+	struct TMeshSourceTraits<FMeshSourceData>
+	{
+		static int32 NumVertices(const FMeshSourceData& Mesh)
+		{
+			return Mesh.Positions.Num();
+		}
+
+		static const FVector3f& GetPosition(const FMeshSourceData& Mesh, uint32 VertexIndex)
+		{
+			return Mesh.Positions[VertexIndex];
+		}
+
+		static FVector3f GetNormal(const FMeshSourceData& Mesh, uint32 VertexIndex)
+		{
+			return Mesh.Normals[VertexIndex];
+		}
+
+		static FVector2f GetUV(const FMeshSourceData& Mesh, uint32 VertexIndex)
+		{
+			return Mesh.UVs.Num() > 0 ? Mesh.UVs[VertexIndex] : FVector2f::ZeroVector;
+		}
+
+		template <typename VisitorType>
+		static void ForEachSection(const FMeshSourceData& Mesh, VisitorType&& Visitor)
+		{
+			for (const FMeshSourceSection& Section : Mesh.Sections)
+			{
+				Visitor(Section.FirstTriangle, Section.NumTriangles, Section.MaterialIndex);
+			}
+		}
+
+		static int32 NumIndices(const FMeshSourceData& Mesh)
+		{
+			return Mesh.Indices.Num();
+		}
+
+		template <typename CallableType>
+		static void VisitIndices(const FMeshSourceData& Mesh, CallableType&& Callable)
+		{
+			if (Mesh.Indices.Num() > 0)
+			{
+				Callable(TConstArrayView<uint32>(Mesh.Indices));
+			}
+		}
+	};
+
+	/**
+	* Calls Visitor(TriangleIndex, A, B, C) with the render vertex indices of every triangle. The loop is
+	* instantiated once per index width and the visitor is inlined into it.
+	*/
+	template <typename MeshType, typename VisitorType>
+	FORCEINLINE void ForEachTriangle(const MeshType& Mesh, VisitorType&& Visitor)
+	{
+		TMeshSourceTraits<MeshType>::VisitIndices(Mesh, [&Visitor](auto Indices)
+		{
+			const auto* Corners = Indices.GetData();
+			const int32 NumTriangles = Indices.Num() / 3;
+			for (int32 TriangleIndex = 0; TriangleIndex < NumTriangles; ++TriangleIndex, Corners += 3)
+			{
+				Visitor(TriangleIndex, uint32(Corners[0]), uint32(Corners[1]), uint32(Corners[2]));
+			}
+		});
+	}
+
+	/**
+	* Calls Visitor(FirstIndex, SecondIndex) for the three sides of every triangle, in the order
+	* FStaticMeshEdgeIterator visits them
+	*/
+	template <typename MeshType, typename VisitorType>
+	FORCEINLINE void ForEachEdge(const MeshType& Mesh, VisitorType&& Visitor)
+	{
+		ForEachTriangle(Mesh, [&Visitor](int32, uint32 A, uint32 B, uint32 C)
+		{
+			Visitor(A, B);
+			Visitor(B, C);
+			Visitor(C, A);
+		});
+	}
+
+	/**
+	* Calls Visitor(VertexIndex, LocalPosition) for every render vertex
+	*/
+	template <typename MeshType, typename VisitorType>
+	FORCEINLINE void ForEachVertex(const MeshType& Mesh, VisitorType&& Visitor)
+	{
+		const int32 NumVertices = TMeshSourceTraits<MeshType>::NumVertices(Mesh);
+		for (int32 VertexIndex = 0; VertexIndex < NumVertices; ++VertexIndex)
+		{
+			Visitor(uint32(VertexIndex), TMeshSourceTraits<MeshType>::GetPosition(Mesh, VertexIndex));
+		}
+	}
+
+	/**
+	* Runs ForEachEdge on one LOD of the component
+	* @return False if the component has no mesh to read
+	*/
+	template <typename VisitorType>
+	bool ForEachEdge(const UStaticMeshComponent* Component, int32 LODIndex, VisitorType&& Visitor)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FMeshDataIterators::ForEachEdge);
+
+		const FStaticMeshLODResources* LODResources = FindLODResources(Component, LODIndex);
+		if (!LODResources)
+		{
+			return false;
+		}
+
+		ForEachEdge(*LODResources, Forward<VisitorType>(Visitor));
+		return true;
+	}
 }
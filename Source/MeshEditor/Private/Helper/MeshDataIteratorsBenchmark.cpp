@@ -0,0 +1,140 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshDataIterators.h"
+#include "MeshEditorStats.h"
+#include "Benchmark/MeshEditorBenchmarkTiming.h"
+#include "Editor.h"
+#include "UObject/UObjectIterator.h"
+#include "Engine/Selection.h"
+#include "Engine/StaticMesh.h"
+#include "Components/StaticMeshComponent.h"
+
+namespace
+{
+	using FMeshEditorBenchmark::TimeBest;
+
+	/** Static mesh components of the selected actors, or of the whole editor world when nothing is selected */
+	TArray<UStaticMeshComponent*> GetBenchmarkComponents()
+	{
+		TArray<UStaticMeshComponent*> Components;
+		if (!GEditor)
+		{
+			return Components;
+		}
+
+		for (FSelectionIterator It(*GEditor->GetSelectedActors()); It; ++It)
+		{
+			if (const AActor* Actor = Cast<AActor>(*It))
+			{
+				Actor->GetComponents<UStaticMeshComponent>(Components, true);
+			}
+		}
+
+		if (Components.Num() == 0)
+		{
+			if (UWorld* World = GEditor->GetEditorWorldContext().World())
+			{
+				for (TObjectIterator<UStaticMeshComponent> It; It; ++It)
+				{
+					if (It->GetWorld() == World)
+					{
+						Components.Add(*It);
+					}
+				}
+			}
+		}
+
+		Components.RemoveAll([](const UStaticMeshComponent* Component)
+		{
+			return !FMeshDataIterators::FindLODResources(Component, 0);
+		});
+		return Components;
+	}
+
+	/**
+	* Compares the virtual edge iterator with the ForEachEdge kernel, reading indices only and reading world space
+	* endpoints. The checksums are logged so the compiler can not drop either loop, and should match.
+	*/
+	void BenchmarkMeshIteration(const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10;
+		const TArray<UStaticMeshComponent*> Components = GetBenchmarkComponents();
+
+		int64 NumEdges = 0;
+		uint64 VirtualIndexSum = 0;
+		uint64 KernelIndexSum = 0;
+		double VirtualLengthSum = 0.0;
+		double KernelLengthSum = 0.0;
+
+		const double VirtualIndexMs = TimeBest(Iterations, [&]
+		{
+			VirtualIndexSum = 0;
+			for (UStaticMeshComponent* Component : Components)
+			{
+				for (TSharedPtr<FMeshDataIterators::FEdgeIterator> It = FMeshDataIterators::MakeEdgeIterator(Component);
+				     *It; ++*It)
+				{
+					VirtualIndexSum += It->FirstEndpointIndex() + It->SecondEndpointIndex();
+				}
+			}
+		});
+
+		const double KernelIndexMs = TimeBest(Iterations, [&]
+		{
+			KernelIndexSum = 0;
+			NumEdges = 0;
+			for (const UStaticMeshComponent* Component : Components)
+			{
+				FMeshDataIterators::ForEachEdge(Component, 0, [&](uint32 First, uint32 Second)
+				{
+					KernelIndexSum += First + Second;
+					++NumEdges;
+				});
+			}
+		});
+
+		const double VirtualLengthMs = TimeBest(Iterations, [&]
+		{
+			VirtualLengthSum = 0.0;
+			for (UStaticMeshComponent* Component : Components)
+			{
+				for (TSharedPtr<FMeshDataIterators::FEdgeIterator> It = FMeshDataIterators::MakeEdgeIterator(Component);
+				     *It; ++*It)
+				{
+					VirtualLengthSum += FVector::Dist(It->FirstEndpoint(), It->SecondEndpoint());
+				}
+			}
+		});
+
+		const double KernelLengthMs = TimeBest(Iterations, [&]
+		{
+			KernelLengthSum = 0.0;
+			for (const UStaticMeshComponent* Component : Components)
+			{
+				const FStaticMeshLODResources& LODResources = *FMeshDataIterators::FindLODResources(Component, 0);
+				const FMatrix LocalToWorld = Component->GetComponentTransform().ToMatrixWithScale();
+				FMeshDataIterators::ForEachEdge(LODResources, [&](uint32 First, uint32 Second)
+				{
+					using FTraits = FMeshDataIterators::TMeshSourceTraits<FStaticMeshLODResources>;
+					KernelLengthSum += FVector::Dist(
+						LocalToWorld.TransformPosition(FVector(FTraits::GetPosition(LODResources, First))),
+						LocalToWorld.TransformPosition(FVector(FTraits::GetPosition(LODResources, Second))));
+				});
+			}
+		});
+
+		UE_LOG(LogMeshEditor, Display, TEXT("Mesh iteration over %d components, %lld edges, best of %d runs"),
+		       Components.Num(), NumEdges, Iterations);
+		UE_LOG(LogMeshEditor, Display, TEXT("  Indices:   virtual %.3f ms, ForEachEdge %.3f ms (checksums %llu, %llu)"),
+		       VirtualIndexMs, KernelIndexMs, VirtualIndexSum, KernelIndexSum);
+		UE_LOG(LogMeshEditor, Display, TEXT("  Endpoints: virtual %.3f ms, ForEachEdge %.3f ms (checksums %.1f, %.1f)"),
+		       VirtualLengthMs, KernelLengthMs, VirtualLengthSum, KernelLengthSum);
+	}
+
+	FAutoConsoleCommand BenchmarkMeshIterationCommand(
+		TEXT("MeshEditor.BenchmarkIteration"),
+		TEXT("Times the virtual mesh edge iterators against the ForEachEdge kernels on the selected static meshes, ")
+		TEXT("or on every static mesh of the level when nothing is selected. Optional argument: number of runs."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkMeshIteration));
+}
@@ -0,0 +1,60 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshDerivedData.h"
+#include "MeshEditorStats.h"
+#include "StaticMeshResources.h"
+#include "Engine/StaticMesh.h"
+#if WITH_EDITOR
+#include "DerivedDataCacheInterface.h"
+#endif
+
+namespace
+{
+	TAutoConsoleVariable<bool> CVarUseDerivedDataCache(
+		TEXT("MeshEditor.UseDerivedDataCache"),
+		true,
+		TEXT("Load the edge tables and BVHs of static meshes from the derived data cache instead of building them ")
+		TEXT("from the render buffers."));
+}
+
+namespace FMeshDerivedData
+{
+	FString MakeKey(const FStaticMeshRenderData& RenderData, int32 LODIndex, const TCHAR* TypeName,
+	                const TCHAR* Version)
+	{
+#if WITH_EDITORONLY_DATA
+		// Meshes built at runtime have no DDC key, nothing else tells two of them apart
+		if (!CVarUseDerivedDataCache.GetValueOnAnyThread() || RenderData.DerivedDataKey.IsEmpty())
+		{
+			return FString();
+		}
+		return FDerivedDataCacheInterface::BuildCacheKey(
+			TEXT("MESHEDITOR"), Version,
+			*FString::Printf(TEXT("%s_%s_LOD%d"), TypeName, *RenderData.DerivedDataKey, LODIndex));
+#else
+		return FString();
+#endif
+	}
+
+	bool Load(const FString& Key, const UStaticMesh* StaticMesh, TArray<uint8>& OutData)
+	{
+#if WITH_EDITOR
+		TRACE_CPUPROFILER_EVENT_SCOPE(FMeshDerivedData::Load);
+		const bool bFound = GetDerivedDataCacheRef().GetSynchronous(*Key, OutData, StaticMesh->GetPathName());
+		UE_LOG(LogMeshEditor, Verbose, TEXT("Derived data %s for %s"), bFound ? TEXT("loaded") : TEXT("missing"),
+		       *Key);
+		return bFound;
+#else
+		return false;
+#endif
+	}
+
+	void Store(const FString& Key, const UStaticMesh* StaticMesh, TConstArrayView<uint8> Data)
+	{
+#if WITH_EDITOR
+		TRACE_CPUPROFILER_EVENT_SCOPE(FMeshDerivedData::Store);
+		GetDerivedDataCacheRef().Put(*Key, Data, StaticMesh->GetPathName());
+#endif
+	}
+}
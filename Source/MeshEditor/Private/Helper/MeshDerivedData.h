@@ -0,0 +1,89 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+class UStaticMesh;
+class FStaticMeshRenderData;
+
+/**
+ * Persists data derived from static mesh LODs in the derived data cache, so it is loaded instead of rebuilt from the
+ * render buffers in later editor sessions. Entries are keyed on the DDC key of the mesh render data, the LOD and a
+ * version string per type of data that has to change whenever its layout or build changes.
+ */
+namespace FMeshDerivedData
+{
+	/** Serializes an array of trivially copyable elements as a single block of memory */
+	template <typename ElementType>
+	void SerializeArray(FArchive& Ar, TArray<ElementType>& Array)
+	{
+		static_assert(std::is_trivially_copyable_v<ElementType>, "Elements are serialized as raw memory");
+
+		int32 Num = Array.Num();
+		Ar << Num;
+		if (Ar.IsLoading())
+		{
+			if (Num < 0 || int64(Num) * sizeof(ElementType) > Ar.TotalSize() - Ar.Tell())
+			{
+				Ar.SetError();
+				return;
+			}
+			Array.SetNumUninitialized(Num);
+		}
+		Ar.Serialize(Array.GetData(), int64(Num) * sizeof(ElementType));
+	}
+
+	/** @return Cache key of the data of the mesh LOD, empty if the render data can not be identified */
+	FString MakeKey(const FStaticMeshRenderData& RenderData, int32 LODIndex, const TCHAR* TypeName,
+	                const TCHAR* Version);
+
+	bool Load(const FString& Key, const UStaticMesh* StaticMesh, TArray<uint8>& OutData);
+
+	void Store(const FString& Key, const UStaticMesh* StaticMesh, TConstArrayView<uint8> Data);
+
+	/**
+	* Loads the value from the cache, or builds it and stores it there. ValueType::Serialize(FArchive&) both reads
+	* and writes the cached data.
+	* @param NewValue Creates the value cached data is read into
+	* @param Build Builds the value on a cache miss, may return null
+	*/
+	template <typename ValueType, typename NewValueFuncType, typename BuildFuncType>
+	TSharedPtr<const ValueType, ESPMode::ThreadSafe> LoadOrBuild(const UStaticMesh* StaticMesh,
+	                                                             const FStaticMeshRenderData& RenderData,
+	                                                             int32 LODIndex, const TCHAR* TypeName,
+	                                                             const TCHAR* Version, NewValueFuncType&& NewValue,
+	                                                             BuildFuncType&& Build)
+	{
+		const FString Key = MakeKey(RenderData, LODIndex, TypeName, Version);
+		if (Key.IsEmpty())
+		{
+			return Build();
+		}
+
+		TArray<uint8> Data;
+		if (Load(Key, StaticMesh, Data))
+		{
+			TSharedPtr<ValueType, ESPMode::ThreadSafe> Value = NewValue();
+			FMemoryReader Reader(Data);
+			Value->Serialize(Reader);
+			if (!Reader.IsError() && Reader.AtEnd())
+			{
+				return Value;
+			}
+		}
+
+		TSharedPtr<const ValueType, ESPMode::ThreadSafe> Value = Build();
+		if (Value.IsValid())
+		{
+			// Saving leaves the value as it is
+			Data.Reset();
+			FMemoryWriter Writer(Data);
+			const_cast<ValueType&>(*Value).Serialize(Writer);
+			Store(Key, StaticMesh, Data);
+		}
+		return Value;
+	}
+}
@@ -0,0 +1,573 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshEdgeTable.h"
+#include "MeshDataIterators.h"
+#include "MeshDerivedData.h"
+#include "MeshEditorStats.h"
+#include "MeshLODCache.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	/** UVs closer than this on either side of an edge are not a seam */
+	constexpr float UVSeamTolerance = 1.e-4f;
+
+	/** Cells of the welding grid along the longest side of the mesh bounds, about a millionth of the mesh size */
+	constexpr int32 WeldGridResolution = 1 << 20;
+
+	/** Welding grid cells are spread over this many hash maps, each filled by its own task */
+	constexpr int32 NumWeldShards = 64;
+
+	/** Render vertices handled by one ParallelFor task while welding */
+	constexpr int32 WeldBatchSize = 16 * 1024;
+
+	TMeshLODCache<FMeshEdgeTable>& GetEdgeTableCache()
+	{
+		static TMeshLODCache<FMeshEdgeTable> EdgeTableCache;
+		return EdgeTableCache;
+	}
+
+	/** Turns the smallest cosine between the cone axis and an adjacent triangle normal into the cone cutoff */
+	void SetConeCutoff(FMeshEdgeCluster& Cluster, float MinCosine)
+	{
+		Cluster.ConeCutoff = MinCosine > 0.f && !Cluster.ConeAxis.IsZero()
+			                     ? FMath::Sqrt(1.f - FMath::Square(MinCosine))
+			                     : 2.f;
+	}
+
+	/**
+	* Sizes the clusters opened while collecting the edges, drops the empty ones and fills their bounds, vertex runs
+	* and normal cones
+	* @param SideEdgeIndices Edge of every triangle side, INDEX_NONE for collapsed sides
+	*/
+	void BuildClusters(FMeshEdgeTable& Table, const TArray<int32>& SideEdgeIndices)
+	{
+		for (int32 ClusterIndex = 0; ClusterIndex < Table.Clusters.Num(); ++ClusterIndex)
+		{
+			const int32 EndEdge = Table.Clusters.IsValidIndex(ClusterIndex + 1)
+				                      ? Table.Clusters[ClusterIndex + 1].FirstEdge
+				                      : Table.Edges.Num();
+			Table.Clusters[ClusterIndex].NumEdges = EndEdge - Table.Clusters[ClusterIndex].FirstEdge;
+		}
+		Table.Clusters.RemoveAll([](const FMeshEdgeCluster& Cluster)
+		{
+			return Cluster.NumEdges == 0;
+		});
+
+		TArray<int32> EdgeClusterIndices;
+		EdgeClusterIndices.SetNumUninitialized(Table.Edges.Num());
+		TArray<uint32> ClusterVertices;
+		for (int32 ClusterIndex = 0; ClusterIndex < Table.Clusters.Num(); ++ClusterIndex)
+		{
+			FMeshEdgeCluster& Cluster = Table.Clusters[ClusterIndex];
+			ClusterVertices.Reset();
+			for (int32 EdgeIndex = Cluster.FirstEdge; EdgeIndex < Cluster.FirstEdge + Cluster.NumEdges; ++EdgeIndex)
+			{
+				const FMeshEdge& Edge = Table.Edges[EdgeIndex];
+				Cluster.Bounds += Table.Positions[Edge.FirstIndex];
+				Cluster.Bounds += Table.Positions[Edge.SecondIndex];
+				ClusterVertices.Add(Edge.FirstIndex);
+				ClusterVertices.Add(Edge.SecondIndex);
+				EdgeClusterIndices[EdgeIndex] = ClusterIndex;
+			}
+
+			// Vertices are mostly numbered in order of use, so the vertices of a cluster collapse into few runs
+			Algo::Sort(ClusterVertices);
+			Cluster.FirstVertexRun = Table.ClusterVertexRuns.Num();
+			for (int32 Index = 0; Index < ClusterVertices.Num(); ++Index)
+			{
+				const int32 Vertex = ClusterVertices[Index];
+				FMeshIndexRun* LastRun = Table.ClusterVertexRuns.Num() > Cluster.FirstVertexRun
+					                         ? &Table.ClusterVertexRuns.Last()
+					                         : nullptr;
+				if (LastRun && Vertex < LastRun->First + LastRun->Num + 1)
+				{
+					LastRun->Num = FMath::Max(LastRun->Num, Vertex - LastRun->First + 1);
+				}
+				else
+				{
+					Table.ClusterVertexRuns.Add(FMeshIndexRun{Vertex, 1});
+				}
+			}
+			Cluster.NumVertexRuns = Table.ClusterVertexRuns.Num() - Cluster.FirstVertexRun;
+		}
+
+		// Normals of every triangle adjacent to an edge of the cluster
+		auto ForEachAdjacentNormal = [&](auto&& Func)
+		{
+			for (int32 Side = 0; Side < SideEdgeIndices.Num(); ++Side)
+			{
+				const FVector3f Normal = Table.FacePlanes.GetNormal(Side / 3);
+				if (SideEdgeIndices[Side] != INDEX_NONE && !Normal.IsZero())
+				{
+					Func(Table.Clusters[EdgeClusterIndices[SideEdgeIndices[Side]]], Normal);
+				}
+			}
+		};
+
+		ForEachAdjacentNormal([](FMeshEdgeCluster& Cluster, const FVector3f& Normal)
+		{
+			Cluster.ConeAxis += Normal;
+		});
+		for (FMeshEdgeCluster& Cluster : Table.Clusters)
+		{
+			Cluster.ConeAxis = Cluster.ConeAxis.GetSafeNormal();
+			Cluster.ConeCutoff = 1.f;
+		}
+
+		// ConeCutoff holds the smallest cosine until every normal has been seen
+		ForEachAdjacentNormal([](FMeshEdgeCluster& Cluster, const FVector3f& Normal)
+		{
+			Cluster.ConeCutoff = FMath::Min(Cluster.ConeCutoff, FVector3f::DotProduct(Cluster.ConeAxis, Normal));
+		});
+		for (FMeshEdgeCluster& Cluster : Table.Clusters)
+		{
+			SetConeCutoff(Cluster, Cluster.ConeCutoff);
+		}
+	}
+
+	/** Fills the face planes from welded positions and normals */
+	template <typename MeshType>
+	void BuildFacePlanes(const MeshType& Mesh, const TArray<uint32>& WeldedVertexIndices,
+	                     const TArray<FVector3f>& Positions, const TArray<FVector3f>& Normals,
+	                     FMeshDataIterators::FFacePlanes& OutPlanes)
+	{
+		OutPlanes.SetNum(FMeshDataIterators::TMeshSourceTraits<MeshType>::NumIndices(Mesh) / 3);
+		FMeshDataIterators::ForEachTriangle(Mesh, [&](int32 TriangleIndex, uint32 RenderA, uint32 RenderB,
+		                                              uint32 RenderC)
+		{
+			const uint32 A = WeldedVertexIndices[RenderA];
+			const uint32 B = WeldedVertexIndices[RenderB];
+			const uint32 C = WeldedVertexIndices[RenderC];
+			FVector3f Normal = FVector3f::CrossProduct(Positions[B] - Positions[A],
+			                                           Positions[C] - Positions[A]).GetSafeNormal();
+			if (FVector3f::DotProduct(Normal, Normals[A] + Normals[B] + Normals[C]) < 0.f)
+			{
+				Normal = -Normal;
+			}
+			OutPlanes.Set(TriangleIndex, Normal, FVector3f::DotProduct(Normal, Positions[A]));
+		});
+	}
+
+	/** Refits the bounds and normal cone of a cluster to a pose, from the first two triangles of each of its edges */
+	void FitClusterToPose(const FMeshEdgeTable& Table, const FMeshEdgePose& Pose, FMeshEdgeCluster& Cluster)
+	{
+		auto ForEachAdjacentNormal = [&](auto&& Func)
+		{
+			for (int32 EdgeIndex = Cluster.FirstEdge; EdgeIndex < Cluster.FirstEdge + Cluster.NumEdges; ++EdgeIndex)
+			{
+				const FIntPoint& Faces = Table.EdgeFaces[EdgeIndex];
+				for (const int32 Face : {Faces.X, Faces.Y})
+				{
+					if (Face != INDEX_NONE && !Pose.FacePlanes.GetNormal(Face).IsZero())
+					{
+						Func(Pose.FacePlanes.GetNormal(Face));
+					}
+				}
+			}
+		};
+
+		Cluster.Bounds = FBox3f(ForceInit);
+		for (int32 EdgeIndex = Cluster.FirstEdge; EdgeIndex < Cluster.FirstEdge + Cluster.NumEdges; ++EdgeIndex)
+		{
+			Cluster.Bounds += Pose.Positions[Table.Edges[EdgeIndex].FirstIndex];
+			Cluster.Bounds += Pose.Positions[Table.Edges[EdgeIndex].SecondIndex];
+		}
+
+		Cluster.ConeAxis = FVector3f::ZeroVector;
+		ForEachAdjacentNormal([&Cluster](const FVector3f& Normal)
+		{
+			Cluster.ConeAxis += Normal;
+		});
+		Cluster.ConeAxis = Cluster.ConeAxis.GetSafeNormal();
+
+		float MinCosine = 1.f;
+		ForEachAdjacentNormal([&Cluster, &MinCosine](const FVector3f& Normal)
+		{
+			MinCosine = FMath::Min(MinCosine, FVector3f::DotProduct(Cluster.ConeAxis, Normal));
+		});
+		SetConeCutoff(Cluster, MinCosine);
+	}
+
+	/**
+	* Fills the edge classes, crease angles and edge faces. The sides of an edge reach its endpoints through different
+	* render vertices wherever the mesh is split, comparing those render vertices finds hard normals and UV seams.
+	* @param SideEdgeIndices Edge of every triangle side, INDEX_NONE for collapsed sides
+	*/
+	template <typename MeshType>
+	void ClassifyEdges(FMeshEdgeTable& Table, const MeshType& Mesh, const TArray<int32>& SideEdgeIndices)
+	{
+		using FTraits = FMeshDataIterators::TMeshSourceTraits<MeshType>;
+		const int32 NumEdges = Table.Edges.Num();
+		const int32 NumTriangles = SideEdgeIndices.Num() / 3;
+
+		TArray<int32> TriangleMaterials;
+		TriangleMaterials.Init(INDEX_NONE, NumTriangles);
+		FTraits::ForEachSection(Mesh, [&TriangleMaterials](int32 FirstTriangle, int32 NumSectionTriangles,
+		                                                   int32 MaterialIndex)
+		{
+			const int32 EndTriangle = FMath::Min(FirstTriangle + NumSectionTriangles, TriangleMaterials.Num());
+			for (int32 TriangleIndex = FirstTriangle; TriangleIndex < EndTriangle; ++TriangleIndex)
+			{
+				TriangleMaterials[TriangleIndex] = MaterialIndex;
+			}
+		});
+
+		// Every further side of an edge is compared with the first one, whose render vertices are kept in edge order
+		struct FFirstSide
+		{
+			uint32 FirstVertex;
+			uint32 SecondVertex;
+			int32 TriangleIndex;
+		};
+		TArray<FFirstSide> FirstSides;
+		FirstSides.SetNumUninitialized(NumEdges);
+		TArray<uint8> NumSides;
+		NumSides.Init(0, NumEdges);
+		TArray<float> MinNormalCosines;
+		MinNormalCosines.Init(1.f, NumEdges);
+		Table.EdgeClasses.Init(EMeshEdgeClass::None, NumEdges);
+		Table.EdgeFaces.Init(FIntPoint(INDEX_NONE, INDEX_NONE), NumEdges);
+
+		FMeshDataIterators::ForEachTriangle(Mesh, [&](int32 TriangleIndex, uint32 A, uint32 B, uint32 C)
+		{
+			const uint32 Corners[3] = {A, B, C};
+			for (int32 Corner = 0; Corner < 3; ++Corner)
+			{
+				const int32 EdgeIndex = SideEdgeIndices[TriangleIndex * 3 + Corner];
+				if (EdgeIndex == INDEX_NONE)
+				{
+					continue;
+				}
+
+				uint32 First = Corners[Corner];
+				uint32 Second = Corners[(Corner + 1) % 3];
+				if (Table.WeldedVertexIndices[First] != Table.Edges[EdgeIndex].FirstIndex)
+				{
+					Swap(First, Second);
+				}
+
+				if (NumSides[EdgeIndex] == 0)
+				{
+					FirstSides[EdgeIndex] = FFirstSide{First, Second, TriangleIndex};
+					Table.EdgeFaces[EdgeIndex].X = TriangleIndex;
+					NumSides[EdgeIndex] = 1;
+					continue;
+				}
+				if (NumSides[EdgeIndex] == 1)
+				{
+					Table.EdgeFaces[EdgeIndex].Y = TriangleIndex;
+				}
+				NumSides[EdgeIndex] = 2;
+
+				const FFirstSide& FirstSide = FirstSides[EdgeIndex];
+				auto CompareRenderVertices = [&](uint32 FirstSideVertex, uint32 Vertex)
+				{
+					if (FirstSideVertex == Vertex)
+					{
+						return;
+					}
+
+					const FVector3f FirstSideNormal = FTraits::GetNormal(Mesh, FirstSideVertex).GetSafeNormal();
+					const float Cosine = FVector3f::DotProduct(FirstSideNormal,
+					                                           FTraits::GetNormal(Mesh, Vertex).GetSafeNormal());
+					MinNormalCosines[EdgeIndex] = FMath::Min(MinNormalCosines[EdgeIndex], Cosine);
+					if (!FTraits::GetUV(Mesh, FirstSideVertex).Equals(FTraits::GetUV(Mesh, Vertex), UVSeamTolerance))
+					{
+						Table.EdgeClasses[EdgeIndex] |= EMeshEdgeClass::UVSeam;
+					}
+				};
+				CompareRenderVertices(FirstSide.FirstVertex, First);
+				CompareRenderVertices(FirstSide.SecondVertex, Second);
+				if (TriangleMaterials[FirstSide.TriangleIndex] != TriangleMaterials[TriangleIndex])
+				{
+					Table.EdgeClasses[EdgeIndex] |= EMeshEdgeClass::Section;
+				}
+			}
+		});
+
+		Table.EdgeCreaseAngles.SetNumUninitialized(NumEdges);
+		for (int32 EdgeIndex = 0; EdgeIndex < NumEdges; ++EdgeIndex)
+		{
+			if (NumSides[EdgeIndex] == 1)
+			{
+				Table.EdgeClasses[EdgeIndex] |= EMeshEdgeClass::Boundary;
+			}
+			Table.EdgeCreaseAngles[EdgeIndex] =
+				FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(MinNormalCosines[EdgeIndex], -1.f, 1.f)));
+		}
+	}
+
+	/**
+	* Welds render vertices rounding to the same cell of a grid over the mesh bounds, and those less than half a cell
+	* apart across a cell border, so that signed zeros and float noise along seams do not split the mesh. Cells are
+	* hashed into shards filled concurrently, then every vertex joins the first vertex of its own cell or of a close
+	* enough neighboring one. Welded vertices are numbered in order of their first render vertex.
+	*/
+	template <typename MeshType>
+	void WeldVertices(FMeshEdgeTable& Table, const MeshType& Mesh)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FMeshEdgeTable::WeldVertices);
+
+		using FTraits = FMeshDataIterators::TMeshSourceTraits<MeshType>;
+		const int32 NumRenderVertices = FTraits::NumVertices(Mesh);
+		Table.WeldedVertexIndices.SetNumUninitialized(NumRenderVertices);
+		if (NumRenderVertices == 0)
+		{
+			return;
+		}
+
+		auto ParallelForBatches = [NumRenderVertices](auto&& Func)
+		{
+			const int32 NumBatches = FMath::DivideAndRoundUp(NumRenderVertices, WeldBatchSize);
+			ParallelFor(NumBatches, [&Func, NumRenderVertices](int32 Batch)
+			{
+				Func(Batch * WeldBatchSize, FMath::Min((Batch + 1) * WeldBatchSize, NumRenderVertices));
+			});
+		};
+
+		FBox3f Bounds(ForceInit);
+		for (int32 VertexIndex = 0; VertexIndex < NumRenderVertices; ++VertexIndex)
+		{
+			Bounds += FTraits::GetPosition(Mesh, VertexIndex);
+		}
+		const float CellSize = FMath::Max(Bounds.GetSize().GetMax() / WeldGridResolution, SMALL_NUMBER);
+		const float WeldDistanceSquared = FMath::Square(CellSize * 0.5f);
+		auto GetGridPosition = [&Mesh, &Bounds, CellSize](int32 VertexIndex)
+		{
+			return (FTraits::GetPosition(Mesh, VertexIndex) - Bounds.Min) / CellSize;
+		};
+
+		TArray<FIntVector> Cells;
+		Cells.SetNumUninitialized(NumRenderVertices);
+		TArray<uint8> Shards;
+		Shards.SetNumUninitialized(NumRenderVertices);
+		ParallelForBatches([&](int32 Begin, int32 End)
+		{
+			for (int32 VertexIndex = Begin; VertexIndex < End; ++VertexIndex)
+			{
+				const FVector3f GridPosition = GetGridPosition(VertexIndex);
+				Cells[VertexIndex] = FIntVector(FMath::RoundToInt(GridPosition.X), FMath::RoundToInt(GridPosition.Y),
+				                                FMath::RoundToInt(GridPosition.Z));
+				Shards[VertexIndex] = GetTypeHash(Cells[VertexIndex]) % NumWeldShards;
+			}
+		});
+
+		// Counting sort by shard, every shard lists its vertices in ascending order
+		TArray<int32> ShardOffsets;
+		ShardOffsets.Init(0, NumWeldShards + 1);
+		for (const uint8 Shard : Shards)
+		{
+			++ShardOffsets[Shard + 1];
+		}
+		for (int32 Shard = 0; Shard < NumWeldShards; ++Shard)
+		{
+			ShardOffsets[Shard + 1] += ShardOffsets[Shard];
+		}
+		TArray<int32> ShardVertices;
+		ShardVertices.SetNumUninitialized(NumRenderVertices);
+		{
+			TArray<int32> Cursors(ShardOffsets.GetData(), NumWeldShards);
+			for (int32 VertexIndex = 0; VertexIndex < NumRenderVertices; ++VertexIndex)
+			{
+				ShardVertices[Cursors[Shards[VertexIndex]]++] = VertexIndex;
+			}
+		}
+
+		TArray<TMap<FIntVector, int32>> FirstVertexByCell;
+		FirstVertexByCell.SetNum(NumWeldShards);
+		ParallelFor(NumWeldShards, [&](int32 Shard)
+		{
+			FirstVertexByCell[Shard].Reserve(ShardOffsets[Shard + 1] - ShardOffsets[Shard]);
+			for (int32 Index = ShardOffsets[Shard]; Index < ShardOffsets[Shard + 1]; ++Index)
+			{
+				const int32 VertexIndex = ShardVertices[Index];
+				FirstVertexByCell[Shard].FindOrAdd(Cells[VertexIndex], VertexIndex);
+			}
+		});
+
+		// A vertex close enough to weld with lies in the cell of the vertex or across its nearest cell borders, the
+		// representative is never after the vertex itself
+		TArray<int32> Representatives;
+		Representatives.SetNumUninitialized(NumRenderVertices);
+		ParallelForBatches([&](int32 Begin, int32 End)
+		{
+			for (int32 VertexIndex = Begin; VertexIndex < End; ++VertexIndex)
+			{
+				const FIntVector& Cell = Cells[VertexIndex];
+				const FVector3f GridPosition = GetGridPosition(VertexIndex);
+				const FIntVector Step(GridPosition.X < Cell.X ? -1 : 1, GridPosition.Y < Cell.Y ? -1 : 1,
+				                      GridPosition.Z < Cell.Z ? -1 : 1);
+				const FVector3f& Position = FTraits::GetPosition(Mesh, VertexIndex);
+
+				int32 Representative = FirstVertexByCell[Shards[VertexIndex]].FindChecked(Cell);
+				for (int32 Neighbor = 1; Neighbor < 8; ++Neighbor)
+				{
+					const FIntVector NeighborCell = Cell + FIntVector((Neighbor & 1) ? Step.X : 0,
+					                                                  (Neighbor & 2) ? Step.Y : 0,
+					                                                  (Neighbor & 4) ? Step.Z : 0);
+					const int32* Candidate = FirstVertexByCell[GetTypeHash(NeighborCell) % NumWeldShards].Find(
+						NeighborCell);
+					if (Candidate && *Candidate < Representative &&
+						FVector3f::DistSquared(FTraits::GetPosition(Mesh, *Candidate), Position) <= WeldDistanceSquared)
+					{
+						Representative = *Candidate;
+					}
+				}
+				Representatives[VertexIndex] = Representative;
+			}
+		});
+
+		// Representatives come first, so their welded vertex is known by the time the vertices joining them are seen
+		for (int32 VertexIndex = 0; VertexIndex < NumRenderVertices; ++VertexIndex)
+		{
+			const int32 Representative = Representatives[VertexIndex];
+			const FVector3f Normal = FTraits::GetNormal(Mesh, VertexIndex);
+			if (Representative == VertexIndex)
+			{
+				Table.WeldedVertexIndices[VertexIndex] = Table.Positions.Add(FTraits::GetPosition(Mesh, VertexIndex));
+				Table.Normals.Add(Normal);
+			}
+			else
+			{
+				const uint32 WeldedIndex = Table.WeldedVertexIndices[Representative];
+				Table.WeldedVertexIndices[VertexIndex] = WeldedIndex;
+				Table.Normals[WeldedIndex] += Normal;
+			}
+		}
+		for (FVector3f& Normal : Table.Normals)
+		{
+			Normal = Normal.GetSafeNormal();
+		}
+	}
+
+	/** Welds the render vertices of the mesh and collects its unique edges into clusters */
+	template <typename MeshType>
+	TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> BuildTable(const MeshType& Mesh)
+	{
+		TSharedPtr<FMeshEdgeTable, ESPMode::ThreadSafe> Table = MakeShared<FMeshEdgeTable, ESPMode::ThreadSafe>();
+
+		WeldVertices(*Table, Mesh);
+
+		// Collect every triangle side once, keeping the order in which they first appear
+		using FTraits = FMeshDataIterators::TMeshSourceTraits<MeshType>;
+		const int32 NumTriangles = FTraits::NumIndices(Mesh) / 3;
+
+		TMap<uint64, int32> EdgeIndexByKey;
+		EdgeIndexByKey.Reserve(NumTriangles * 3 / 2);
+		Table->Edges.Reserve(NumTriangles * 3 / 2);
+		TArray<int32> SideEdgeIndices;
+		SideEdgeIndices.Init(INDEX_NONE, NumTriangles * 3);
+		FMeshDataIterators::ForEachTriangle(Mesh, [&](int32 TriangleIndex, uint32 A, uint32 B, uint32 C)
+		{
+			if (TriangleIndex % FMeshEdgeTable::TrianglesPerCluster == 0)
+			{
+				Table->Clusters.Add(FMeshEdgeCluster{
+					FBox3f(ForceInit), FVector3f::ZeroVector, 0.f, Table->Edges.Num(), 0, 0, 0
+				});
+			}
+
+			const uint32 Corners[3] = {
+				Table->WeldedVertexIndices[A], Table->WeldedVertexIndices[B], Table->WeldedVertexIndices[C]
+			};
+			for (int32 Corner = 0; Corner < 3; ++Corner)
+			{
+				const uint32 First = Corners[Corner];
+				const uint32 Second = Corners[(Corner + 1) % 3];
+				if (First == Second)
+				{
+					continue;
+				}
+
+				int32& SideEdgeIndex = SideEdgeIndices[TriangleIndex * 3 + Corner];
+				const uint64 EdgeKey = FMeshEdgeTable::MakeEdgeKey(First, Second);
+				if (const int32* EdgeIndex = EdgeIndexByKey.Find(EdgeKey))
+				{
+					SideEdgeIndex = *EdgeIndex;
+				}
+				else
+				{
+					SideEdgeIndex = Table->Edges.Add(FMeshEdge{First, Second});
+					EdgeIndexByKey.Add(EdgeKey, SideEdgeIndex);
+				}
+			}
+		});
+
+		BuildFacePlanes(Mesh, Table->WeldedVertexIndices, Table->Positions, Table->Normals, Table->FacePlanes);
+		BuildClusters(*Table, SideEdgeIndices);
+		ClassifyEdges(*Table, Mesh, SideEdgeIndices);
+		Table->Edges.Shrink();
+
+		return Table;
+	}
+}
+
+TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> FMeshEdgeTable::FindOrBuild(const UStaticMesh* StaticMesh,
+                                                                                 int32 LODIndex)
+{
+	return GetEdgeTableCache().FindOrBuild(StaticMesh, LODIndex,
+	                                       [StaticMesh, LODIndex](const FStaticMeshRenderData& RenderData,
+	                                                              const FStaticMeshLODResources& LODResources)
+	                                       {
+		                                       return FMeshDerivedData::LoadOrBuild<FMeshEdgeTable>(
+			                                       StaticMesh, RenderData, LODIndex, TEXT("EDGETABLE"),
+			                                       DerivedDataVersion,
+			                                       [] { return MakeShared<FMeshEdgeTable, ESPMode::ThreadSafe>(); },
+			                                       [&LODResources] { return Build(LODResources); });
+	                                       });
+}
+
+FMeshEdgePosePtr FMeshEdgeTable::FitPose(const FMeshSourceData& MeshSource, TArray<FVector3f> PosedPositions,
+                                         TArray<FVector3f> PosedNormals) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMeshEdgeTable::FitPose);
+
+	check(PosedPositions.Num() == NumVertices() && PosedNormals.Num() == NumVertices());
+	TSharedPtr<FMeshEdgePose, ESPMode::ThreadSafe> Pose = MakeShared<FMeshEdgePose, ESPMode::ThreadSafe>();
+	Pose->Positions = MoveTemp(PosedPositions);
+	Pose->Normals = MoveTemp(PosedNormals);
+	BuildFacePlanes(MeshSource, WeldedVertexIndices, Pose->Positions, Pose->Normals, Pose->FacePlanes);
+
+	Pose->Clusters = Clusters;
+	ParallelFor(Pose->Clusters.Num(), [this, &Pose](int32 ClusterIndex)
+	{
+		FitClusterToPose(*this, *Pose, Pose->Clusters[ClusterIndex]);
+	});
+	return Pose;
+}
+
+void FMeshEdgeTable::Serialize(FArchive& Ar)
+{
+	FMeshDerivedData::SerializeArray(Ar, Positions);
+	FMeshDerivedData::SerializeArray(Ar, Normals);
+	FMeshDerivedData::SerializeArray(Ar, Edges);
+	FMeshDerivedData::SerializeArray(Ar, WeldedVertexIndices);
+	FMeshDerivedData::SerializeArray(Ar, EdgeClasses);
+	FMeshDerivedData::SerializeArray(Ar, EdgeCreaseAngles);
+	FMeshDerivedData::SerializeArray(Ar, FacePlanes.NX);
+	FMeshDerivedData::SerializeArray(Ar, FacePlanes.NY);
+	FMeshDerivedData::SerializeArray(Ar, FacePlanes.NZ);
+	FMeshDerivedData::SerializeArray(Ar, FacePlanes.W);
+	FMeshDerivedData::SerializeArray(Ar, EdgeFaces);
+	FMeshDerivedData::SerializeArray(Ar, Clusters);
+	FMeshDerivedData::SerializeArray(Ar, ClusterVertexRuns);
+}
+
+void FMeshEdgeTable::RemoveUnusedTables()
+{
+	GetEdgeTableCache().RemoveUnused();
+}
+
+TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> FMeshEdgeTable::Build(const FStaticMeshLODResources& LODResources)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMeshEdgeTable::Build);
+	return BuildTable(LODResources);
+}
+
+TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> FMeshEdgeTable::Build(const FMeshSourceData& MeshSource)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMeshEdgeTable::Build);
+	return BuildTable(MeshSource);
+}
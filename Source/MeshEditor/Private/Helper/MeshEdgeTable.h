@@ -0,0 +1,148 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MeshEdgeClass.h"
+#include "Helper/MeshDataIterators.h"
+
+class UStaticMesh;
+struct FMeshSourceData;
+struct FStaticMeshLODResources;
+
+/** An undirected edge between two welded vertices of a FMeshEdgeTable */
+struct FMeshEdge
+{
+	uint32 FirstIndex;
+	uint32 SecondIndex;
+};
+
+/** Consecutive indices from First to First + Num - 1 */
+struct FMeshIndexRun
+{
+	int32 First;
+	int32 Num;
+};
+
+/** Edges first seen in a run of consecutive triangles, along with what is needed to cull them together */
+struct FMeshEdgeCluster
+{
+	/** Bounds of the edge endpoints in mesh local space */
+	FBox3f Bounds;
+	/** Average normal of the triangles adjacent to the edges */
+	FVector3f ConeAxis;
+	/** Sine of the widest angle between ConeAxis and an adjacent triangle normal, above one if it exceeds 90 degrees */
+	float ConeCutoff;
+	int32 FirstEdge;
+	int32 NumEdges;
+	/** Runs of the vertices used by the edges, in FMeshEdgeTable::ClusterVertexRuns */
+	int32 FirstVertexRun;
+	int32 NumVertexRuns;
+};
+
+/**
+ * Welded vertices of a FMeshEdgeTable in another pose of its mesh, e.g. a skinned pose, along with the face planes and
+ * clusters that move with them. Edges, their classes and the cluster ranges stay those of the table.
+ */
+struct FMeshEdgePose
+{
+	TArray<FVector3f> Positions;
+	TArray<FVector3f> Normals;
+	FMeshDataIterators::FFacePlanes FacePlanes;
+	/** Clusters of the table with their bounds and normal cones fit to the pose */
+	TArray<FMeshEdgeCluster> Clusters;
+};
+
+using FMeshEdgePosePtr = TSharedPtr<const FMeshEdgePose, ESPMode::ThreadSafe>;
+
+/**
+ * Unique edges of one static mesh LOD or FMeshSourceData. Render vertices sharing a position, up to float noise, are
+ * welded together, so interior edges and edges split by UV or normal seams are stored only once.
+ */
+class FMeshEdgeTable
+{
+public:
+	/**
+	* @return The shared edge table of the mesh LOD, built on first use and cached until the render data changes
+	*/
+	static TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> FindOrBuild(const UStaticMesh* StaticMesh,
+	                                                                        int32 LODIndex);
+
+	/** Releases cached tables of meshes that no longer exist or that nothing references anymore */
+	static void RemoveUnusedTables();
+
+	static TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> Build(const FStaticMeshLODResources& LODResources);
+
+	/** Builds an uncached table, for meshes that are not static meshes */
+	static TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> Build(const FMeshSourceData& MeshSource);
+
+	/** Changes whenever the layout or the build of tables changes, so tables in the derived data cache are rebuilt */
+	static constexpr const TCHAR* DerivedDataVersion = TEXT("FF058590792D4AC79D61385021C1EC9E");
+
+	/** Triangles whose new edges are grouped in one cluster */
+	static constexpr int32 TrianglesPerCluster = 256;
+
+	/** @return A key identifying the undirected edge between two welded vertices */
+	static uint64 MakeEdgeKey(uint32 A, uint32 B)
+	{
+		return A < B ? (uint64(A) << 32) | B : (uint64(B) << 32) | A;
+	}
+
+	int32 NumVertices() const
+	{
+		return Positions.Num();
+	}
+
+	int32 NumEdges() const
+	{
+		return Edges.Num();
+	}
+
+	/** @return The EMeshEdgeClass flags of the edge, with Crease set if its sides meet at more than CreaseAngle */
+	EMeshEdgeClass GetEdgeClass(int32 EdgeIndex, float CreaseAngle) const
+	{
+		EMeshEdgeClass EdgeClass = EdgeClasses[EdgeIndex];
+		if (EdgeCreaseAngles[EdgeIndex] > CreaseAngle)
+		{
+			EdgeClass |= EMeshEdgeClass::Crease;
+		}
+		return EdgeClass != EMeshEdgeClass::None ? EdgeClass : EMeshEdgeClass::Smooth;
+	}
+
+	/**
+	* Fits the table to another pose of the mesh it was built from. Normal cones are fit to the first two triangles
+	* of every edge, further triangles of non-manifold edges are not seen.
+	* @param MeshSource Mesh the table was built from, only its triangles are read
+	* @param PosedPositions Position of every welded vertex in the pose, in mesh local space
+	* @param PosedNormals Normal of every welded vertex in the pose
+	*/
+	FMeshEdgePosePtr FitPose(const FMeshSourceData& MeshSource, TArray<FVector3f> PosedPositions,
+	                         TArray<FVector3f> PosedNormals) const;
+
+	/** Reads or writes the table for the derived data cache */
+	void Serialize(FArchive& Ar);
+
+public:
+	/** Welded vertex positions in mesh local space */
+	TArray<FVector3f> Positions;
+	/** Normals of the welded vertices in mesh local space, averaged over the render vertices welded together */
+	TArray<FVector3f> Normals;
+	/** Unique edges in order of first appearance in the index buffer */
+	TArray<FMeshEdge> Edges;
+	/** Welded vertex index of each render vertex */
+	TArray<uint32> WeldedVertexIndices;
+	/** Boundary, UVSeam and Section flags of each edge. Crease and Smooth depend on the angle, see GetEdgeClass */
+	TArray<EMeshEdgeClass> EdgeClasses;
+	/** Widest angle in degrees between the vertex normals on either side of each edge, zero for boundary edges */
+	TArray<float> EdgeCreaseAngles;
+	/**
+	* Plane of every triangle of the index buffer over the welded positions, facing the side the vertex normals point
+	* to since the winding of front faces is not something the index buffer tells
+	*/
+	FMeshDataIterators::FFacePlanes FacePlanes;
+	/** The first two triangles sharing each edge, Y is INDEX_NONE for boundary edges */
+	TArray<FIntPoint> EdgeFaces;
+	/** Consecutive ranges of Edges, in order */
+	TArray<FMeshEdgeCluster> Clusters;
+	TArray<FMeshIndexRun> ClusterVertexRuns;
+};
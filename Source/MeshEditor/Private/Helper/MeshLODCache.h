@@ -0,0 +1,103 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StaticMesh.h"
+#include "StaticMeshResources.h"
+#include "UObject/ObjectKey.h"
+
+/**
+ * Thread safe cache of data derived from one LOD of a static mesh. Entries are keyed on the mesh and LOD index and
+ * are rebuilt whenever the mesh render data they were built from is replaced.
+ */
+template <typename ValueType>
+class TMeshLODCache
+{
+public:
+	using FValuePtr = TSharedPtr<const ValueType, ESPMode::ThreadSafe>;
+
+	/**
+	* @return The cached value for the mesh LOD, building it with BuildFunc if it is missing or out of date
+	*/
+	template <typename BuildFuncType>
+	FValuePtr FindOrBuild(const UStaticMesh* StaticMesh, int32 LODIndex, BuildFuncType&& BuildFunc)
+	{
+		const FStaticMeshRenderData* RenderData = StaticMesh ? StaticMesh->GetRenderData() : nullptr;
+		if (!RenderData || !RenderData->LODResources.IsValidIndex(LODIndex))
+		{
+			return nullptr;
+		}
+
+		const FKey Key{StaticMesh, LODIndex};
+		{
+			FScopeLock ScopeLock(&Lock);
+			if (const FEntry* Entry = Entries.Find(Key))
+			{
+				if (Entry->IsBuiltFrom(RenderData))
+				{
+					return Entry->Value;
+				}
+			}
+		}
+
+		// Build outside of the lock so that different meshes can be processed concurrently
+		FValuePtr NewValue = BuildFunc(*RenderData, RenderData->LODResources[LODIndex]);
+
+		FScopeLock ScopeLock(&Lock);
+		FEntry& Entry = Entries.FindOrAdd(Key);
+		if (!Entry.IsBuiltFrom(RenderData))
+		{
+			Entry.RenderData = RenderData;
+#if WITH_EDITORONLY_DATA
+			Entry.DerivedDataKey = RenderData->DerivedDataKey;
+#endif
+			Entry.Value = NewValue;
+		}
+		return Entry.Value;
+	}
+
+	/** Drops entries whose static mesh has been destroyed or whose value nothing outside the cache holds */
+	void RemoveUnused()
+	{
+		FScopeLock ScopeLock(&Lock);
+		for (auto It = Entries.CreateIterator(); It; ++It)
+		{
+			const FValuePtr& Value = It->Value.Value;
+			if (!It->Key.Key.ResolveObjectPtr() || !Value.IsValid() || Value.GetSharedReferenceCount() == 1)
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+
+	void Empty()
+	{
+		FScopeLock ScopeLock(&Lock);
+		Entries.Empty();
+	}
+
+private:
+	using FKey = TPair<TObjectKey<UStaticMesh>, int32>;
+
+	struct FEntry
+	{
+		bool IsBuiltFrom(const FStaticMeshRenderData* InRenderData) const
+		{
+#if WITH_EDITORONLY_DATA
+			return RenderData == InRenderData && DerivedDataKey == InRenderData->DerivedDataKey;
+#else
+			return RenderData == InRenderData;
+#endif
+		}
+
+		const FStaticMeshRenderData* RenderData{nullptr};
+#if WITH_EDITORONLY_DATA
+		FString DerivedDataKey;
+#endif
+		FValuePtr Value;
+	};
+
+	FCriticalSection Lock;
+	TMap<FKey, FEntry> Entries;
+};
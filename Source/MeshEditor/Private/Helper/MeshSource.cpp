@@ -0,0 +1,430 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshSource.h"
+#include "MeshBVH.h"
+#include "MeshEdgeTable.h"
+#include "MeshEditorStats.h"
+#include "Async/ParallelFor.h"
+#include "Components/DynamicMeshComponent.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "DynamicMesh/DynamicMesh3.h"
+#include "DynamicMesh/DynamicMeshAttributeSet.h"
+#include "Engine/SkinnedAsset.h"
+#include "Rendering/SkeletalMeshRenderData.h"
+#include "UObject/ObjectKey.h"
+
+namespace FMeshSources
+{
+	namespace
+	{
+		/** Vertices skinned by one task */
+		constexpr int32 SkinningBatchSize = 1024;
+
+		struct FSourceEntry
+		{
+			int32 LODIndex{0};
+			/** Render data the source was extracted from, a new one means a new mesh or a rebuild */
+			const void* RenderData{nullptr};
+			/** Hash of the bone matrices of skinned meshes */
+			uint32 PoseHash{0};
+			FMeshSourceDataPtr Data;
+		};
+
+		TMap<TObjectKey<UPrimitiveComponent>, FSourceEntry>& GetSourceCache()
+		{
+			static TMap<TObjectKey<UPrimitiveComponent>, FSourceEntry> SourceCache;
+			return SourceCache;
+		}
+
+		/** Hash of the pose CapturePose last captured of each skinned mesh component */
+		TMap<TObjectKey<UPrimitiveComponent>, uint32>& GetCapturedPoseHashes()
+		{
+			static TMap<TObjectKey<UPrimitiveComponent>, uint32> CapturedPoseHashes;
+			return CapturedPoseHashes;
+		}
+
+		/** Skinned edges of each skinned asset LOD, read and filled from the collection tasks */
+		struct FSkinnedEdgesCache
+		{
+			struct FEntry
+			{
+				/** Render data the edges were built from, a new one means a new mesh or a rebuild */
+				const FSkeletalMeshRenderData* RenderData{nullptr};
+				FMeshSkinnedEdgesPtr Edges;
+			};
+
+			FCriticalSection Lock;
+			TMap<TPair<TObjectKey<USkinnedAsset>, int32>, FEntry> Entries;
+		};
+
+		FSkinnedEdgesCache& GetSkinnedEdgesCache()
+		{
+			static FSkinnedEdgesCache SkinnedEdgesCache;
+			return SkinnedEdgesCache;
+		}
+
+		FSkeletalMeshRenderData* GetSkinnedRenderData(USkinnedMeshComponent* Component, int32& InOutLODIndex)
+		{
+			FSkeletalMeshRenderData* RenderData = Component->GetSkeletalMeshRenderData();
+			if (!RenderData || RenderData->LODRenderData.Num() == 0)
+			{
+				return nullptr;
+			}
+			InOutLODIndex = FMath::Clamp(InOutLODIndex, 0, RenderData->LODRenderData.Num() - 1);
+			return Component->GetSkinWeightBuffer(InOutLODIndex) ? RenderData : nullptr;
+		}
+
+		uint32 GetPoseHash(const TArray<FMatrix44f>& RefToLocals)
+		{
+			return FCrc::MemCrc32(RefToLocals.GetData(), RefToLocals.Num() * RefToLocals.GetTypeSize());
+		}
+
+		/** Copies the index buffer and the sections of the LOD */
+		void CopyTriangles(const FSkeletalMeshLODRenderData& LODData, FMeshSourceData& OutData)
+		{
+			LODData.MultiSizeIndexContainer.GetIndexBuffer(OutData.Indices);
+			for (const FSkelMeshRenderSection& Section : LODData.RenderSections)
+			{
+				OutData.Sections.Add(FMeshSourceSection{
+					int32(Section.BaseIndex / 3), int32(Section.NumTriangles), int32(Section.MaterialIndex)
+				});
+			}
+		}
+
+		FMeshSourceDataPtr SkinMesh(USkinnedMeshComponent* Component, FSkeletalMeshLODRenderData& LODData,
+		                            FSkinWeightVertexBuffer& SkinWeights, TArray<FMatrix44f>& RefToLocals)
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FMeshSources::SkinMesh);
+
+			TSharedPtr<FMeshSourceData, ESPMode::ThreadSafe> Data = MakeShared<FMeshSourceData, ESPMode::ThreadSafe>();
+			const int32 NumVertices = LODData.GetNumVertices();
+			Data->Positions.SetNumUninitialized(NumVertices);
+			Data->Normals.SetNumUninitialized(NumVertices);
+			const FStaticMeshVertexBuffer& VertexBuffer = LODData.StaticVertexBuffers.StaticMeshVertexBuffer;
+			if (VertexBuffer.GetNumTexCoords() > 0)
+			{
+				Data->UVs.SetNumUninitialized(NumVertices);
+			}
+
+			// The bone matrices and buffers are only read, every batch writes its own vertices
+			ParallelFor(FMath::DivideAndRoundUp(NumVertices, SkinningBatchSize), [&](int32 BatchIndex)
+			{
+				const int32 EndVertex = FMath::Min((BatchIndex + 1) * SkinningBatchSize, NumVertices);
+				for (int32 VertexIndex = BatchIndex * SkinningBatchSize; VertexIndex < EndVertex; ++VertexIndex)
+				{
+					FVector3f TangentX;
+					FVector3f TangentY;
+					FVector3f TangentZ;
+					USkinnedMeshComponent::GetSkinnedTangentBasis(Component, VertexIndex, LODData, SkinWeights,
+					                                              RefToLocals, TangentX, TangentY, TangentZ);
+					Data->Positions[VertexIndex] = USkinnedMeshComponent::GetSkinnedVertexPosition(
+						Component, VertexIndex, LODData, SkinWeights, RefToLocals);
+					Data->Normals[VertexIndex] = TangentZ.GetSafeNormal();
+					if (Data->UVs.Num() > 0)
+					{
+						Data->UVs[VertexIndex] = VertexBuffer.GetVertexUV(VertexIndex, 0);
+					}
+				}
+			});
+
+			CopyTriangles(LODData, *Data);
+			return Data;
+		}
+
+		/** Copies the render vertices as they are in the vertex buffers, which hold the bind pose */
+		FMeshSourceDataPtr ExtractBindPose(const FSkeletalMeshLODRenderData& LODData)
+		{
+			TSharedPtr<FMeshSourceData, ESPMode::ThreadSafe> Data = MakeShared<FMeshSourceData, ESPMode::ThreadSafe>();
+			const int32 NumVertices = LODData.GetNumVertices();
+			const FPositionVertexBuffer& PositionBuffer = LODData.StaticVertexBuffers.PositionVertexBuffer;
+			const FStaticMeshVertexBuffer& VertexBuffer = LODData.StaticVertexBuffers.StaticMeshVertexBuffer;
+			Data->Positions.SetNumUninitialized(NumVertices);
+			Data->Normals.SetNumUninitialized(NumVertices);
+			if (VertexBuffer.GetNumTexCoords() > 0)
+			{
+				Data->UVs.SetNumUninitialized(NumVertices);
+			}
+			for (int32 VertexIndex = 0; VertexIndex < NumVertices; ++VertexIndex)
+			{
+				Data->Positions[VertexIndex] = PositionBuffer.VertexPosition(VertexIndex);
+				Data->Normals[VertexIndex] = FVector3f{VertexBuffer.VertexTangentZ(VertexIndex)};
+				if (Data->UVs.Num() > 0)
+				{
+					Data->UVs[VertexIndex] = VertexBuffer.GetVertexUV(VertexIndex, 0);
+				}
+			}
+
+			CopyTriangles(LODData, *Data);
+			return Data;
+		}
+
+		FMeshSkinnedEdgesPtr BuildSkinnedEdges(const FSkeletalMeshLODRenderData& LODData)
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FMeshSources::BuildSkinnedEdges);
+
+			TSharedPtr<FMeshSkinnedEdges, ESPMode::ThreadSafe> Edges =
+				MakeShared<FMeshSkinnedEdges, ESPMode::ThreadSafe>();
+			Edges->BindPose = ExtractBindPose(LODData);
+			Edges->EdgeTable = FMeshEdgeTable::Build(*Edges->BindPose);
+			Edges->BVH = FMeshBVH::Build(*Edges->BindPose, Edges->EdgeTable);
+
+			// Counting sort of the render vertices by welded vertex, each group keeps ascending render vertex order
+			const TArray<uint32>& WeldedVertexIndices = Edges->EdgeTable->WeldedVertexIndices;
+			Edges->RenderVertexOffsets.Init(0, Edges->EdgeTable->NumVertices() + 1);
+			for (const uint32 WeldedIndex : WeldedVertexIndices)
+			{
+				++Edges->RenderVertexOffsets[WeldedIndex + 1];
+			}
+			for (int32 WeldedIndex = 0; WeldedIndex < Edges->EdgeTable->NumVertices(); ++WeldedIndex)
+			{
+				Edges->RenderVertexOffsets[WeldedIndex + 1] += Edges->RenderVertexOffsets[WeldedIndex];
+			}
+			TArray<int32> Cursors(Edges->RenderVertexOffsets.GetData(), Edges->EdgeTable->NumVertices());
+			Edges->RenderVertices.SetNumUninitialized(WeldedVertexIndices.Num());
+			for (int32 VertexIndex = 0; VertexIndex < WeldedVertexIndices.Num(); ++VertexIndex)
+			{
+				Edges->RenderVertices[Cursors[WeldedVertexIndices[VertexIndex]]++] = VertexIndex;
+			}
+			return Edges;
+		}
+
+		/** Copies the vertices in compact order, dynamic meshes may have holes in their vertex ids */
+		FMeshSourceDataPtr CopyMesh(const UE::Geometry::FDynamicMesh3& Mesh)
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FMeshSources::CopyMesh);
+
+			TSharedPtr<FMeshSourceData, ESPMode::ThreadSafe> Data = MakeShared<FMeshSourceData, ESPMode::ThreadSafe>();
+			TArray<uint32> CompactIndices;
+			CompactIndices.SetNumUninitialized(Mesh.MaxVertexID());
+			Data->Positions.Reserve(Mesh.VertexCount());
+			for (const int32 VertexID : Mesh.VertexIndicesItr())
+			{
+				CompactIndices[VertexID] = Data->Positions.Add(FVector3f{Mesh.GetVertex(VertexID)});
+			}
+
+			// Area weighted vertex normals, the normal overlay may be split or missing
+			Data->Normals.SetNumZeroed(Data->Positions.Num());
+			Data->Indices.Reserve(Mesh.TriangleCount() * 3);
+			const UE::Geometry::FDynamicMeshMaterialAttribute* MaterialIDs =
+				Mesh.HasAttributes() ? Mesh.Attributes()->GetMaterialID() : nullptr;
+			for (const int32 TriangleID : Mesh.TriangleIndicesItr())
+			{
+				// Consecutive triangles with the same material id share a section
+				const int32 MaterialIndex = MaterialIDs ? MaterialIDs->GetValue(TriangleID) : 0;
+				if (Data->Sections.Num() == 0 || Data->Sections.Last().MaterialIndex != MaterialIndex)
+				{
+					Data->Sections.Add(FMeshSourceSection{Data->Indices.Num() / 3, 0, MaterialIndex});
+				}
+				++Data->Sections.Last().NumTriangles;
+
+				const UE::Geometry::FIndex3i Triangle = Mesh.GetTriangle(TriangleID);
+				const uint32 A = CompactIndices[Triangle.A];
+				const uint32 B = CompactIndices[Triangle.B];
+				const uint32 C = CompactIndices[Triangle.C];
+				Data->Indices.Append({A, B, C});
+
+				const FVector3f Normal = FVector3f::CrossProduct(Data->Positions[B] - Data->Positions[A],
+				                                                 Data->Positions[C] - Data->Positions[A]);
+				Data->Normals[A] += Normal;
+				Data->Normals[B] += Normal;
+				Data->Normals[C] += Normal;
+			}
+			for (FVector3f& Normal : Data->Normals)
+			{
+				Normal = Normal.GetSafeNormal();
+			}
+			return Data;
+		}
+	}
+
+	bool IsSupported(const UPrimitiveComponent* Component)
+	{
+		return Component && (Component->IsA<USkinnedMeshComponent>() || Component->IsA<UDynamicMeshComponent>());
+	}
+
+	FMeshSourceDataPtr FindOrExtract(UPrimitiveComponent* Component, int32 LODIndex)
+	{
+		check(IsInGameThread());
+
+		if (USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(Component))
+		{
+			FSkeletalMeshRenderData* RenderData = GetSkinnedRenderData(SkinnedComponent, LODIndex);
+			if (!RenderData)
+			{
+				return nullptr;
+			}
+
+			TArray<FMatrix44f> RefToLocals;
+			SkinnedComponent->CacheRefToLocalMatrices(RefToLocals);
+			const uint32 PoseHash = GetPoseHash(RefToLocals);
+
+			FSourceEntry& Entry = GetSourceCache().FindOrAdd(Component);
+			if (!Entry.Data.IsValid() || Entry.LODIndex != LODIndex || Entry.RenderData != RenderData ||
+				Entry.PoseHash != PoseHash)
+			{
+				Entry.Data = SkinMesh(SkinnedComponent, RenderData->LODRenderData[LODIndex],
+				                      *SkinnedComponent->GetSkinWeightBuffer(LODIndex), RefToLocals);
+				Entry.LODIndex = LODIndex;
+				Entry.RenderData = RenderData;
+				Entry.PoseHash = PoseHash;
+			}
+			return Entry.Data;
+		}
+
+		if (UDynamicMeshComponent* DynamicComponent = Cast<UDynamicMeshComponent>(Component))
+		{
+			FSourceEntry& Entry = GetSourceCache().FindOrAdd(Component);
+			if (!Entry.Data.IsValid())
+			{
+				DynamicComponent->ProcessMesh([&Entry](const UE::Geometry::FDynamicMesh3& Mesh)
+				{
+					Entry.Data = CopyMesh(Mesh);
+				});
+			}
+			return Entry.Data;
+		}
+
+		return nullptr;
+	}
+
+	bool CapturePose(USkinnedMeshComponent* Component, int32 LODIndex, FMeshSkinnedPose& OutPose)
+	{
+		check(IsInGameThread());
+
+		FSkeletalMeshRenderData* RenderData = GetSkinnedRenderData(Component, LODIndex);
+		if (!RenderData || !Component->GetSkinnedAsset())
+		{
+			return false;
+		}
+
+		OutPose.Component = Component;
+		OutPose.SkinnedAsset = Component->GetSkinnedAsset();
+		OutPose.RenderData = RenderData;
+		OutPose.LODIndex = LODIndex;
+		OutPose.SkinWeights = Component->GetSkinWeightBuffer(LODIndex);
+		Component->CacheRefToLocalMatrices(OutPose.RefToLocals);
+		OutPose.PoseHash = GetPoseHash(OutPose.RefToLocals);
+		GetCapturedPoseHashes().Add(Component, OutPose.PoseHash);
+		return true;
+	}
+
+	bool HasPoseChanged(USkinnedMeshComponent* Component, int32 LODIndex)
+	{
+		check(IsInGameThread());
+
+		const uint32* CapturedPoseHash = GetCapturedPoseHashes().Find(Component);
+		if (!CapturedPoseHash || !GetSkinnedRenderData(Component, LODIndex))
+		{
+			return false;
+		}
+
+		TArray<FMatrix44f> RefToLocals;
+		Component->CacheRefToLocalMatrices(RefToLocals);
+		return *CapturedPoseHash != GetPoseHash(RefToLocals);
+	}
+
+	FMeshSkinnedEdgesPtr FindOrBuildSkinnedEdges(const FMeshSkinnedPose& Pose)
+	{
+		if (!Pose.RenderData || !Pose.RenderData->LODRenderData.IsValidIndex(Pose.LODIndex))
+		{
+			return nullptr;
+		}
+
+		FSkinnedEdgesCache& Cache = GetSkinnedEdgesCache();
+		const TPair<TObjectKey<USkinnedAsset>, int32> Key{Pose.SkinnedAsset, Pose.LODIndex};
+		{
+			FScopeLock ScopeLock(&Cache.Lock);
+			const FSkinnedEdgesCache::FEntry* Entry = Cache.Entries.Find(Key);
+			if (Entry && Entry->RenderData == Pose.RenderData)
+			{
+				return Entry->Edges;
+			}
+		}
+
+		// Build outside of the lock so that different assets can be processed concurrently
+		FMeshSkinnedEdgesPtr NewEdges = BuildSkinnedEdges(Pose.RenderData->LODRenderData[Pose.LODIndex]);
+
+		FScopeLock ScopeLock(&Cache.Lock);
+		FSkinnedEdgesCache::FEntry& Entry = Cache.Entries.FindOrAdd(Key);
+		if (Entry.RenderData != Pose.RenderData)
+		{
+			Entry.RenderData = Pose.RenderData;
+			Entry.Edges = NewEdges;
+		}
+		return Entry.Edges;
+	}
+
+	TSharedPtr<const FMeshEdgePose, ESPMode::ThreadSafe> SkinPose(const FMeshSkinnedEdges& Edges,
+	                                                             const FMeshSkinnedPose& Pose)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FMeshSources::SkinPose);
+
+		const FSkeletalMeshLODRenderData& LODData = Pose.RenderData->LODRenderData[Pose.LODIndex];
+		const int32 NumVertices = Edges.EdgeTable->NumVertices();
+		TArray<FVector3f> Positions;
+		Positions.SetNumUninitialized(NumVertices);
+		TArray<FVector3f> Normals;
+		Normals.SetNumUninitialized(NumVertices);
+
+		// The engine takes the bone matrices by mutable reference but only reads them, the tasks share one copy
+		TArray<FMatrix44f> RefToLocals = Pose.RefToLocals;
+		ParallelFor(FMath::DivideAndRoundUp(NumVertices, SkinningBatchSize), [&](int32 BatchIndex)
+		{
+			const int32 EndVertex = FMath::Min((BatchIndex + 1) * SkinningBatchSize, NumVertices);
+			for (int32 VertexIndex = BatchIndex * SkinningBatchSize; VertexIndex < EndVertex; ++VertexIndex)
+			{
+				const int32 FirstRenderVertex = Edges.RenderVertexOffsets[VertexIndex];
+				const int32 EndRenderVertex = Edges.RenderVertexOffsets[VertexIndex + 1];
+				Positions[VertexIndex] = USkinnedMeshComponent::GetSkinnedVertexPosition(
+					Pose.Component, Edges.RenderVertices[FirstRenderVertex], LODData, *Pose.SkinWeights,
+					RefToLocals);
+
+				FVector3f Normal{FVector3f::ZeroVector};
+				for (int32 Index = FirstRenderVertex; Index < EndRenderVertex; ++Index)
+				{
+					FVector3f TangentX;
+					FVector3f TangentY;
+					FVector3f TangentZ;
+					USkinnedMeshComponent::GetSkinnedTangentBasis(Pose.Component, Edges.RenderVertices[Index], LODData,
+					                                              *Pose.SkinWeights, RefToLocals, TangentX, TangentY,
+					                                              TangentZ);
+					Normal += TangentZ;
+				}
+				Normals[VertexIndex] = Normal.GetSafeNormal();
+			}
+		});
+
+		return Edges.EdgeTable->FitPose(*Edges.BindPose, MoveTemp(Positions), MoveTemp(Normals));
+	}
+
+	void Invalidate(const UPrimitiveComponent* Component)
+	{
+		GetSourceCache().Remove(Component);
+		GetCapturedPoseHashes().Remove(Component);
+
+		const USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(Component);
+		if (const USkinnedAsset* SkinnedAsset = SkinnedComponent ? SkinnedComponent->GetSkinnedAsset() : nullptr)
+		{
+			FSkinnedEdgesCache& Cache = GetSkinnedEdgesCache();
+			FScopeLock ScopeLock(&Cache.Lock);
+			for (auto It = Cache.Entries.CreateIterator(); It; ++It)
+			{
+				if (It->Key.Key == TObjectKey<USkinnedAsset>(SkinnedAsset))
+				{
+					It.RemoveCurrent();
+				}
+			}
+		}
+	}
+
+	void Reset()
+	{
+		GetSourceCache().Empty();
+		GetCapturedPoseHashes().Empty();
+
+		FSkinnedEdgesCache& Cache = GetSkinnedEdgesCache();
+		FScopeLock ScopeLock(&Cache.Lock);
+		Cache.Entries.Empty();
+	}
+}
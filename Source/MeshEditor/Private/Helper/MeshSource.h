@@ -0,0 +1,118 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FMeshBVH;
+class FMeshEdgeTable;
+class FSkeletalMeshRenderData;
+class FSkinWeightVertexBuffer;
+class UPrimitiveComponent;
+class USkinnedAsset;
+class USkinnedMeshComponent;
+struct FMeshEdgePose;
+
+/** Triangles FirstTriangle to FirstTriangle + NumTriangles - 1 of a FMeshSourceData, drawn with one material */
+struct FMeshSourceSection
+{
+	int32 FirstTriangle;
+	int32 NumTriangles;
+	int32 MaterialIndex;
+};
+
+/**
+ * Render vertices and triangles of a mesh that is not a static mesh, in component space. Taken on the game thread so
+ * it can be read from any thread afterwards; skeletal meshes are skinned for the pose they had then, or left in their
+ * bind pose for FMeshSkinnedEdges.
+ */
+struct FMeshSourceData
+{
+	TArray<FVector3f> Positions;
+	TArray<FVector3f> Normals;
+	/** First UV channel of each vertex, empty if the mesh has none or its vertices are not split along UV seams */
+	TArray<FVector2f> UVs;
+	TArray<uint32> Indices;
+	TArray<FMeshSourceSection> Sections;
+};
+
+using FMeshSourceDataPtr = TSharedPtr<const FMeshSourceData, ESPMode::ThreadSafe>;
+
+/** Bone matrices of a skinned mesh component for one LOD, captured on the game thread to be skinned on any other */
+struct FMeshSkinnedPose
+{
+	USkinnedMeshComponent* Component{nullptr};
+	const USkinnedAsset* SkinnedAsset{nullptr};
+	FSkeletalMeshRenderData* RenderData{nullptr};
+	/** LOD of the render data, clamped to the LODs it has */
+	int32 LODIndex{0};
+	FSkinWeightVertexBuffer* SkinWeights{nullptr};
+	TArray<FMatrix44f> RefToLocals;
+	/** Hash of RefToLocals, poses with the same hash are taken to be the same */
+	uint32 PoseHash{0};
+};
+
+/**
+ * Edges of one skinned asset LOD, built once from its bind pose and shared by every component and pose of it. Poses
+ * only move the welded vertices, see FMeshSources::SkinPose.
+ */
+struct FMeshSkinnedEdges
+{
+	/** Render vertices and triangles in the bind pose, the edge table and BVH are built from them */
+	FMeshSourceDataPtr BindPose;
+	TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> EdgeTable;
+	TSharedPtr<const FMeshBVH, ESPMode::ThreadSafe> BVH;
+	/**
+	* Render vertices welded into each edge table vertex, those of vertex V are RenderVertices[RenderVertexOffsets[V]]
+	* up to RenderVertices[RenderVertexOffsets[V + 1]], the first render vertex of V first
+	*/
+	TArray<int32> RenderVertexOffsets;
+	TArray<int32> RenderVertices;
+};
+
+using FMeshSkinnedEdgesPtr = TSharedPtr<const FMeshSkinnedEdges, ESPMode::ThreadSafe>;
+
+/**
+ * Extraction of FMeshSourceData from skinned and dynamic mesh components, on the game thread unless stated otherwise
+ */
+namespace FMeshSources
+{
+	/** @return True for the component types FindOrExtract reads */
+	bool IsSupported(const UPrimitiveComponent* Component);
+
+	/**
+	* @return The mesh of one LOD of the component. Skinned meshes are skinned in parallel and the result is reused
+	* until their pose changes, dynamic meshes are copied once and reused until Invalidate is called. Null for
+	* static meshes, which are read directly.
+	*/
+	FMeshSourceDataPtr FindOrExtract(UPrimitiveComponent* Component, int32 LODIndex);
+
+	/**
+	* Captures the current pose of one LOD of a skinned mesh component, HasPoseChanged compares against it from then on
+	* @return False if the component has nothing to skin
+	*/
+	bool CapturePose(USkinnedMeshComponent* Component, int32 LODIndex, FMeshSkinnedPose& OutPose);
+
+	/** @return True if the component has been posed differently since its pose was last captured */
+	bool HasPoseChanged(USkinnedMeshComponent* Component, int32 LODIndex);
+
+	/**
+	* @return The shared edges of the skinned asset LOD of the pose, built on first use and cached until the render
+	* data changes. Safe to call from any thread.
+	*/
+	FMeshSkinnedEdgesPtr FindOrBuildSkinnedEdges(const FMeshSkinnedPose& Pose);
+
+	/**
+	* Skins the welded vertices of the edges in parallel and fits the edge table to them. Each vertex is placed at its
+	* first render vertex, its normal averages those of all its render vertices. Safe to call from any thread.
+	* @param Pose Pose of a component of the asset LOD the edges were built from
+	*/
+	TSharedPtr<const FMeshEdgePose, ESPMode::ThreadSafe> SkinPose(const FMeshSkinnedEdges& Edges,
+	                                                             const FMeshSkinnedPose& Pose);
+
+	/** Drops the cached mesh of the component, and the skinned edges of its asset, e.g. because it was edited */
+	void Invalidate(const UPrimitiveComponent* Component);
+
+	/** Drops every cached mesh, captured pose and skinned edges */
+	void Reset();
+}
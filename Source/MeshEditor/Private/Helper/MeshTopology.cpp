@@ -0,0 +1,450 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshTopology.h"
+#include "MeshDataIterators.h"
+#include "MeshEditorStats.h"
+#include "MeshLODCache.h"
+#include "Algo/Reverse.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	/** Elements handled by one ParallelFor task */
+	constexpr int32 ElementsPerTask = 16 * 1024;
+
+	/** Half-edges around one vertex past which loop walks give up on it */
+	constexpr int32 MaxFanSize = 64;
+
+	TMeshLODCache<FMeshTopology>& GetTopologyCache()
+	{
+		static TMeshLODCache<FMeshTopology> TopologyCache;
+		return TopologyCache;
+	}
+
+	/** Runs Func(Begin, End) over consecutive ranges of Num elements in parallel */
+	template <typename FuncType>
+	void ParallelForRanges(int32 Num, FuncType&& Func)
+	{
+		ParallelFor(FMath::DivideAndRoundUp(Num, ElementsPerTask), [&Func, Num](int32 TaskIndex)
+		{
+			Func(TaskIndex * ElementsPerTask, FMath::Min((TaskIndex + 1) * ElementsPerTask, Num));
+		});
+	}
+
+	/** Fills the welded triangle corners and groups the half-edges that are not collapsed by origin */
+	template <typename MeshType>
+	void BuildHalfEdges(FMeshTopology& Topology, const MeshType& Mesh)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FMeshTopology::BuildHalfEdges);
+
+		using FTraits = FMeshDataIterators::TMeshSourceTraits<MeshType>;
+		const int32 NumHalfEdges = FTraits::NumIndices(Mesh) / 3 * 3;
+		Topology.TriangleVertices.SetNumUninitialized(NumHalfEdges);
+		const TArray<uint32>& WeldedVertexIndices = Topology.EdgeTable->WeldedVertexIndices;
+		FTraits::VisitIndices(Mesh, [&Topology, &WeldedVertexIndices, NumHalfEdges](auto Indices)
+		{
+			ParallelForRanges(NumHalfEdges, [&](int32 Begin, int32 End)
+			{
+				for (int32 HalfEdge = Begin; HalfEdge < End; ++HalfEdge)
+				{
+					Topology.TriangleVertices[HalfEdge] = WeldedVertexIndices[Indices[HalfEdge]];
+				}
+			});
+		});
+
+		// Kept serial so that the half-edges of every vertex stay in triangle order from one build to the next
+		Topology.VertexOffsets.Init(0, Topology.NumVertices() + 1);
+		for (int32 HalfEdge = 0; HalfEdge < NumHalfEdges; ++HalfEdge)
+		{
+			if (Topology.GetOrigin(HalfEdge) != Topology.GetDestination(HalfEdge))
+			{
+				++Topology.VertexOffsets[Topology.GetOrigin(HalfEdge) + 1];
+			}
+		}
+		for (int32 Vertex = 0; Vertex < Topology.NumVertices(); ++Vertex)
+		{
+			Topology.VertexOffsets[Vertex + 1] += Topology.VertexOffsets[Vertex];
+		}
+
+		Topology.OutgoingHalfEdges.SetNumUninitialized(Topology.VertexOffsets.Last());
+		TArray<int32> Cursors(Topology.VertexOffsets.GetData(), Topology.NumVertices());
+		for (int32 HalfEdge = 0; HalfEdge < NumHalfEdges; ++HalfEdge)
+		{
+			if (Topology.GetOrigin(HalfEdge) != Topology.GetDestination(HalfEdge))
+			{
+				Topology.OutgoingHalfEdges[Cursors[Topology.GetOrigin(HalfEdge)]++] = HalfEdge;
+			}
+		}
+	}
+
+	/** Pairs every half-edge with the only half-edge running the other way between the same vertices */
+	void LinkTwins(FMeshTopology& Topology)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FMeshTopology::LinkTwins);
+
+		Topology.Twins.SetNumUninitialized(Topology.NumHalfEdges());
+		ParallelForRanges(Topology.NumHalfEdges(), [&Topology](int32 Begin, int32 End)
+		{
+			for (int32 HalfEdge = Begin; HalfEdge < End; ++HalfEdge)
+			{
+				const int32 Origin = Topology.GetOrigin(HalfEdge);
+				const int32 Destination = Topology.GetDestination(HalfEdge);
+				if (Origin == Destination)
+				{
+					Topology.Twins[HalfEdge] = FMeshTopology::NonManifoldTwin;
+					continue;
+				}
+
+				int32 NumSame = 0;
+				for (const int32 Other : Topology.GetOutgoingHalfEdges(Origin))
+				{
+					NumSame += Topology.GetDestination(Other) == Destination;
+				}
+				int32 NumOpposite = 0;
+				int32 Opposite = INDEX_NONE;
+				for (const int32 Other : Topology.GetOutgoingHalfEdges(Destination))
+				{
+					if (Topology.GetDestination(Other) == Origin)
+					{
+						++NumOpposite;
+						Opposite = Other;
+					}
+				}
+
+				if (NumSame == 1 && NumOpposite <= 1)
+				{
+					Topology.Twins[HalfEdge] = NumOpposite == 1 ? Opposite : FMeshTopology::BoundaryTwin;
+				}
+				else
+				{
+					Topology.Twins[HalfEdge] = FMeshTopology::NonManifoldTwin;
+				}
+			}
+		});
+	}
+
+	template <typename MeshType>
+	TSharedPtr<const FMeshTopology, ESPMode::ThreadSafe> BuildTopology(
+		const MeshType& Mesh,
+		const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable)
+	{
+		if (!EdgeTable.IsValid())
+		{
+			return nullptr;
+		}
+
+		TSharedPtr<FMeshTopology, ESPMode::ThreadSafe> Topology = MakeShared<FMeshTopology, ESPMode::ThreadSafe>();
+		Topology->EdgeTable = EdgeTable;
+		BuildHalfEdges(*Topology, Mesh);
+		LinkTwins(*Topology);
+		return Topology;
+	}
+}
+
+TSharedPtr<const FMeshTopology, ESPMode::ThreadSafe> FMeshTopology::FindOrBuild(const UStaticMesh* StaticMesh,
+                                                                               int32 LODIndex)
+{
+	return GetTopologyCache().FindOrBuild(StaticMesh, LODIndex,
+	                                      [StaticMesh, LODIndex](const FStaticMeshRenderData&,
+	                                                             const FStaticMeshLODResources& LODResources)
+	                                      {
+		                                      return Build(LODResources,
+		                                                   FMeshEdgeTable::FindOrBuild(StaticMesh, LODIndex));
+	                                      });
+}
+
+void FMeshTopology::RemoveUnusedTopologies()
+{
+	GetTopologyCache().RemoveUnused();
+}
+
+TSharedPtr<const FMeshTopology, ESPMode::ThreadSafe> FMeshTopology::Build(
+	const FStaticMeshLODResources& LODResources,
+	const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMeshTopology::Build);
+	return BuildTopology(LODResources, EdgeTable);
+}
+
+TSharedPtr<const FMeshTopology, ESPMode::ThreadSafe> FMeshTopology::Build(
+	const FMeshSourceData& MeshSource,
+	const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMeshTopology::Build);
+	return BuildTopology(MeshSource, EdgeTable);
+}
+
+int32 FMeshTopology::FindHalfEdge(int32 A, int32 B) const
+{
+	for (const int32 HalfEdge : GetOutgoingHalfEdges(A))
+	{
+		if (GetDestination(HalfEdge) == B)
+		{
+			return HalfEdge;
+		}
+	}
+	return INDEX_NONE;
+}
+
+bool FMeshTopology::IsBoundaryVertex(int32 Vertex) const
+{
+	// The boundary half-edge entering the vertex is the previous one of a triangle around it
+	for (const int32 HalfEdge : GetOutgoingHalfEdges(Vertex))
+	{
+		if (IsBoundary(HalfEdge) || IsBoundary(GetPrev(HalfEdge)))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FMeshTopology::GetOneRing(int32 Vertex, TArray<int32>& OutVertices) const
+{
+	OutVertices.Reset();
+	for (const int32 HalfEdge : GetOutgoingHalfEdges(Vertex))
+	{
+		OutVertices.AddUnique(GetDestination(HalfEdge));
+		OutVertices.AddUnique(GetOrigin(GetPrev(HalfEdge)));
+	}
+}
+
+void FMeshTopology::GetVertexTriangles(int32 Vertex, TArray<int32>& OutTriangles) const
+{
+	OutTriangles.Reset();
+	for (const int32 HalfEdge : GetOutgoingHalfEdges(Vertex))
+	{
+		// A triangle with a collapsed side may leave the vertex twice
+		OutTriangles.AddUnique(GetTriangle(HalfEdge));
+	}
+}
+
+void FMeshTopology::GetEdgeTriangles(int32 A, int32 B, TArray<int32>& OutTriangles) const
+{
+	OutTriangles.Reset();
+	for (const int32 HalfEdge : GetOutgoingHalfEdges(A))
+	{
+		if (GetDestination(HalfEdge) == B)
+		{
+			OutTriangles.Add(GetTriangle(HalfEdge));
+		}
+	}
+	for (const int32 HalfEdge : GetOutgoingHalfEdges(B))
+	{
+		if (GetDestination(HalfEdge) == A)
+		{
+			OutTriangles.Add(GetTriangle(HalfEdge));
+		}
+	}
+}
+
+void FMeshTopology::GetBoundaryLoops(TArray<TArray<int32>>& OutLoops) const
+{
+	OutLoops.Reset();
+	TBitArray<> Visited(false, NumHalfEdges());
+	for (int32 Start = 0; Start < NumHalfEdges(); ++Start)
+	{
+		if (!IsBoundary(Start) || Visited[Start])
+		{
+			continue;
+		}
+
+		TArray<int32>& Loop = OutLoops.AddDefaulted_GetRef();
+		int32 HalfEdge = Start;
+		while (HalfEdge != INDEX_NONE)
+		{
+			Visited[HalfEdge] = true;
+			Loop.Add(GetOrigin(HalfEdge));
+
+			// Where loops touch, the vertex has several boundary half-edges leaving it. The loop closes as soon as
+			// it can, otherwise it goes on along any boundary half-edge not walked yet.
+			int32 NextHalfEdge = INDEX_NONE;
+			for (const int32 Candidate : GetOutgoingHalfEdges(GetDestination(HalfEdge)))
+			{
+				if (Candidate == Start)
+				{
+					NextHalfEdge = INDEX_NONE;
+					break;
+				}
+				if (NextHalfEdge == INDEX_NONE && IsBoundary(Candidate) && !Visited[Candidate])
+				{
+					NextHalfEdge = Candidate;
+				}
+			}
+			HalfEdge = NextHalfEdge;
+		}
+	}
+}
+
+bool FMeshTopology::IsQuadDiagonal(int32 HalfEdge) const
+{
+	const int32 Twin = Twins[HalfEdge];
+	if (Twin < 0)
+	{
+		return false;
+	}
+
+	auto LengthSquared = [this](int32 Side)
+	{
+		return FVector3f::DistSquared(GetPosition(GetOrigin(Side)), GetPosition(GetDestination(Side)));
+	};
+	const float DiagonalSquared = LengthSquared(HalfEdge);
+	return DiagonalSquared > LengthSquared(GetNext(HalfEdge)) && DiagonalSquared > LengthSquared(GetPrev(HalfEdge)) &&
+		DiagonalSquared > LengthSquared(GetNext(Twin)) && DiagonalSquared > LengthSquared(GetPrev(Twin));
+}
+
+bool FMeshTopology::FindEdgeLoop(int32 HalfEdge, TArray<int32>& OutHalfEdges) const
+{
+	OutHalfEdges.Reset();
+	OutHalfEdges.Add(HalfEdge);
+	if (Twins[HalfEdge] == NonManifoldTwin || IsQuadDiagonal(HalfEdge))
+	{
+		return false;
+	}
+
+	// Half-edge leaving the destination of Incoming that carries the loop on, INDEX_NONE where the loop ends
+	auto ContinueInterior = [this](int32 Incoming)
+	{
+		// Quad edges around the vertex in fan order, starting with the way back
+		TArray<int32, TInlineAllocator<MaxFanSize>> Spokes;
+		const int32 Start = Twins[Incoming];
+		int32 Outgoing = Start;
+		for (int32 Step = 0; Step < MaxFanSize; ++Step)
+		{
+			if (!IsQuadDiagonal(Outgoing))
+			{
+				Spokes.Add(Outgoing);
+			}
+
+			// Stepping into the next triangle around the vertex fails at borders and non-manifold edges
+			Outgoing = Twins[GetPrev(Outgoing)];
+			if (Outgoing < 0)
+			{
+				return INDEX_NONE;
+			}
+			if (Outgoing == Start)
+			{
+				return Spokes.Num() == 4 ? Spokes[2] : INDEX_NONE;
+			}
+		}
+		return INDEX_NONE;
+	};
+
+	// The border half-edge leaving the destination of Incoming, or entering the origin of Outgoing
+	auto ContinueBoundary = [this](int32 HalfEdgeAtEnd, bool bForward)
+	{
+		int32 Found = INDEX_NONE;
+		const int32 Vertex = bForward ? GetDestination(HalfEdgeAtEnd) : GetOrigin(HalfEdgeAtEnd);
+		for (const int32 Outgoing : GetOutgoingHalfEdges(Vertex))
+		{
+			const int32 Candidate = bForward ? Outgoing : GetPrev(Outgoing);
+			if (IsBoundary(Candidate))
+			{
+				if (Found != INDEX_NONE)
+				{
+					// Several borders meet at the vertex, there is no single way on
+					return int32(INDEX_NONE);
+				}
+				Found = Candidate;
+			}
+		}
+		return Found;
+	};
+
+	const bool bBoundary = IsBoundary(HalfEdge);
+	for (int32 Current = HalfEdge; OutHalfEdges.Num() < NumHalfEdges();)
+	{
+		Current = bBoundary ? ContinueBoundary(Current, true) : ContinueInterior(Current);
+		if (Current == HalfEdge)
+		{
+			return true;
+		}
+		if (Current == INDEX_NONE)
+		{
+			break;
+		}
+		OutHalfEdges.Add(Current);
+	}
+
+	// Open loop, walk the other way from the start and put those half-edges in front, pointing along the loop
+	TArray<int32> Backward;
+	int32 Current = bBoundary ? HalfEdge : Twins[HalfEdge];
+	while (OutHalfEdges.Num() + Backward.Num() < NumHalfEdges())
+	{
+		Current = bBoundary ? ContinueBoundary(Current, false) : ContinueInterior(Current);
+		if (Current == INDEX_NONE)
+		{
+			break;
+		}
+		Backward.Add(bBoundary ? Current : Twins[Current]);
+	}
+	Algo::Reverse(Backward);
+	OutHalfEdges.Insert(Backward, 0);
+	return false;
+}
+
+bool FMeshTopology::FindEdgeRing(int32 HalfEdge, TArray<int32>& OutHalfEdges) const
+{
+	OutHalfEdges.Reset();
+	OutHalfEdges.Add(HalfEdge);
+	if (Twins[HalfEdge] == NonManifoldTwin || IsQuadDiagonal(HalfEdge))
+	{
+		return false;
+	}
+
+	// Side of the quad of Side across from it, INDEX_NONE if the triangle of Side is not part of a quad
+	auto FindOppositeSide = [this](int32 Side)
+	{
+		int32 QuadSides[4];
+		int32 NumQuadSides = 0;
+		int32 Current = Side;
+		do
+		{
+			if (IsQuadDiagonal(Current))
+			{
+				Current = GetNext(Twins[Current]);
+				continue;
+			}
+			if (NumQuadSides == 4)
+			{
+				return int32(INDEX_NONE);
+			}
+			QuadSides[NumQuadSides++] = Current;
+			Current = GetNext(Current);
+		}
+		while (Current != Side);
+		return NumQuadSides == 4 ? QuadSides[2] : int32(INDEX_NONE);
+	};
+
+	// Each step crosses one quad and hands over to the quad on the far side of the opposite edge
+	auto Walk = [&](int32 Start, TArray<int32>& OutSides)
+	{
+		for (int32 Current = Start; Current >= 0 && OutHalfEdges.Num() + OutSides.Num() < NumHalfEdges();)
+		{
+			const int32 Opposite = FindOppositeSide(Current);
+			if (Opposite == INDEX_NONE)
+			{
+				break;
+			}
+			if (Opposite == Twins[HalfEdge])
+			{
+				return true;
+			}
+			OutSides.Add(Opposite);
+			Current = Twins[Opposite];
+		}
+		return false;
+	};
+
+	if (Walk(HalfEdge, OutHalfEdges))
+	{
+		return true;
+	}
+
+	TArray<int32> Backward;
+	Walk(Twins[HalfEdge], Backward);
+	Algo::Reverse(Backward);
+	OutHalfEdges.Insert(Backward, 0);
+	return false;
+}
@@ -0,0 +1,161 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Helper/MeshEdgeTable.h"
+
+class UStaticMesh;
+struct FStaticMeshLODResources;
+struct FMeshSourceData;
+
+/**
+ * Half-edge connectivity of one static mesh LOD or FMeshSourceData. Its vertices are the welded vertices of the edge
+ * table, so the triangles on either side of UV and normal seams are connected and edge table vertices need no
+ * mapping. Half-edge 3 * T + C of triangle T runs from its corner C to the next corner, which keeps Next, Prev and
+ * the triangle of a half-edge implicit.
+ */
+class FMeshTopology
+{
+public:
+	/** Twin of the half-edges no other triangle shares */
+	static constexpr int32 BoundaryTwin = INDEX_NONE;
+	/**
+	* Twin of the collapsed half-edges, and of those shared by more than two triangles or by two triangles of opposite
+	* winding. These are not part of any boundary loop.
+	*/
+	static constexpr int32 NonManifoldTwin = -2;
+
+	/**
+	* @return The shared topology of the mesh LOD, built on first use and cached until the render data changes
+	*/
+	static TSharedPtr<const FMeshTopology, ESPMode::ThreadSafe> FindOrBuild(const UStaticMesh* StaticMesh,
+	                                                                       int32 LODIndex);
+
+	/** Releases cached topologies of meshes that no longer exist or that nothing references anymore */
+	static void RemoveUnusedTopologies();
+
+	static TSharedPtr<const FMeshTopology, ESPMode::ThreadSafe> Build(
+		const FStaticMeshLODResources& LODResources,
+		const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable);
+
+	/**
+	* Builds an uncached topology, for meshes that are not static meshes. EdgeTable must be built from the same
+	* source.
+	*/
+	static TSharedPtr<const FMeshTopology, ESPMode::ThreadSafe> Build(
+		const FMeshSourceData& MeshSource,
+		const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable);
+
+	int32 NumVertices() const
+	{
+		return EdgeTable->NumVertices();
+	}
+
+	/** @return The position of the vertex in mesh local space */
+	const FVector3f& GetPosition(int32 Vertex) const
+	{
+		return EdgeTable->Positions[Vertex];
+	}
+
+	int32 NumTriangles() const
+	{
+		return TriangleVertices.Num() / 3;
+	}
+
+	int32 NumHalfEdges() const
+	{
+		return TriangleVertices.Num();
+	}
+
+	static int32 GetTriangle(int32 HalfEdge)
+	{
+		return HalfEdge / 3;
+	}
+
+	static int32 GetNext(int32 HalfEdge)
+	{
+		return HalfEdge % 3 == 2 ? HalfEdge - 2 : HalfEdge + 1;
+	}
+
+	static int32 GetPrev(int32 HalfEdge)
+	{
+		return HalfEdge % 3 == 0 ? HalfEdge + 2 : HalfEdge - 1;
+	}
+
+	int32 GetOrigin(int32 HalfEdge) const
+	{
+		return TriangleVertices[HalfEdge];
+	}
+
+	int32 GetDestination(int32 HalfEdge) const
+	{
+		return TriangleVertices[GetNext(HalfEdge)];
+	}
+
+	bool IsBoundary(int32 HalfEdge) const
+	{
+		return Twins[HalfEdge] == BoundaryTwin;
+	}
+
+	/** @return The half-edges leaving the vertex, collapsed ones excluded, in triangle order */
+	TConstArrayView<int32> GetOutgoingHalfEdges(int32 Vertex) const
+	{
+		return TConstArrayView<int32>(OutgoingHalfEdges.GetData() + VertexOffsets[Vertex],
+		                              VertexOffsets[Vertex + 1] - VertexOffsets[Vertex]);
+	}
+
+	/** @return A half-edge from A to B, INDEX_NONE if no triangle has that side */
+	int32 FindHalfEdge(int32 A, int32 B) const;
+
+	/** @return True if the vertex has a boundary half-edge leaving or entering it */
+	bool IsBoundaryVertex(int32 Vertex) const;
+
+	/** Collects the vertices sharing an edge with the vertex, each once */
+	void GetOneRing(int32 Vertex, TArray<int32>& OutVertices) const;
+
+	/** Collects the triangles around the vertex, each once */
+	void GetVertexTriangles(int32 Vertex, TArray<int32>& OutTriangles) const;
+
+	/** Collects every triangle with a side between A and B, more than two if the edge is non-manifold */
+	void GetEdgeTriangles(int32 A, int32 B, TArray<int32>& OutTriangles) const;
+
+	/**
+	* Chains the boundary half-edges into loops of vertices, each loop in the direction of its half-edges. A vertex
+	* where several loops touch appears in each of them.
+	*/
+	void GetBoundaryLoops(TArray<TArray<int32>>& OutLoops) const;
+
+	/**
+	* @return True if the half-edge is the longest side of both triangles sharing it. Those two triangles are then
+	* taken as one quad, which is how quad continuation rules apply to triangulated meshes.
+	*/
+	bool IsQuadDiagonal(int32 HalfEdge) const;
+
+	/**
+	* Walks the edge loop through a half-edge. Interior loops go straight on through vertices joining four quad
+	* edges and stop at any other vertex. Loops along an open border follow the border instead.
+	* @param OutHalfEdges Half-edges of the loop from one end to the other, all pointing the same way
+	* @return True if the loop closes on itself
+	*/
+	bool FindEdgeLoop(int32 HalfEdge, TArray<int32>& OutHalfEdges) const;
+
+	/**
+	* Walks the edge ring through a half-edge, stepping to the opposite side of the quads on either side of it. The
+	* ring stops at triangles that are not part of a quad and at open borders.
+	* @param OutHalfEdges One half-edge of every edge of the ring, from one end to the other
+	* @return True if the ring closes on itself
+	*/
+	bool FindEdgeRing(int32 HalfEdge, TArray<int32>& OutHalfEdges) const;
+
+public:
+	/** Edge table the topology was built over, it holds the vertices */
+	TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> EdgeTable;
+	/** Welded vertex at every corner of every triangle, which is also the origin of every half-edge */
+	TArray<int32> TriangleVertices;
+	/** Opposite half-edge of every half-edge, or BoundaryTwin or NonManifoldTwin */
+	TArray<int32> Twins;
+	/** Half-edges grouped by origin, those of vertex V are from VertexOffsets[V] to VertexOffsets[V + 1] - 1 */
+	TArray<int32> VertexOffsets;
+	TArray<int32> OutgoingHalfEdges;
+};
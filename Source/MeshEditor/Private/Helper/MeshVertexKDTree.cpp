@@ -0,0 +1,199 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshVertexKDTree.h"
+#include "MeshEditorStats.h"
+#include "MeshLODCache.h"
+
+namespace
+{
+	TMeshLODCache<FMeshVertexKDTree>& GetTreeCache()
+	{
+		static TMeshLODCache<FMeshVertexKDTree> TreeCache;
+		return TreeCache;
+	}
+
+	/** Partially sorts Order so that Order[Nth] holds the vertex it would hold if sorted along Axis */
+	void SelectNth(TArray<int32>& Order, int32 First, int32 Last, int32 Nth, const TArray<FVector3f>& Positions,
+	               int32 Axis)
+	{
+		while (Last - First > 1)
+		{
+			const float Pivot = Positions[Order[(First + Last) / 2]][Axis];
+			int32 Low = First;
+			int32 High = Last - 1;
+			while (Low <= High)
+			{
+				while (Positions[Order[Low]][Axis] < Pivot)
+				{
+					++Low;
+				}
+				while (Positions[Order[High]][Axis] > Pivot)
+				{
+					--High;
+				}
+				if (Low <= High)
+				{
+					Swap(Order[Low++], Order[High--]);
+				}
+			}
+
+			if (Nth <= High)
+			{
+				Last = High + 1;
+			}
+			else if (Nth >= Low)
+			{
+				First = Low;
+			}
+			else
+			{
+				return;
+			}
+		}
+	}
+}
+
+struct FMeshVertexKDTree::FQuery
+{
+	FVector3f Position;
+	FVector3f ScaleSquared;
+	int32 K;
+	int32 ExcludedVertex;
+	/** Nearest vertices found so far, sorted nearest first */
+	TArray<FMeshVertexNeighbor>& Neighbors;
+	float MaxDistanceSquared;
+
+	/** @return Squared distance beyond which vertices can no longer make it into the result */
+	float GetBoundSquared() const
+	{
+		return Neighbors.Num() < K ? MaxDistanceSquared : Neighbors.Last().DistanceSquared;
+	}
+
+	void Add(int32 VertexIndex, float DistanceSquared)
+	{
+		int32 InsertIndex = Neighbors.Num();
+		while (InsertIndex > 0 && Neighbors[InsertIndex - 1].DistanceSquared > DistanceSquared)
+		{
+			--InsertIndex;
+		}
+		Neighbors.Insert(FMeshVertexNeighbor{VertexIndex, DistanceSquared}, InsertIndex);
+		if (Neighbors.Num() > K)
+		{
+			Neighbors.Pop(false);
+		}
+	}
+};
+
+TSharedPtr<const FMeshVertexKDTree, ESPMode::ThreadSafe> FMeshVertexKDTree::FindOrBuild(const UStaticMesh* StaticMesh,
+                                                                                       int32 LODIndex)
+{
+	return GetTreeCache().FindOrBuild(StaticMesh, LODIndex,
+	                                  [StaticMesh, LODIndex](const FStaticMeshRenderData&, const FStaticMeshLODResources&)
+	                                  {
+		                                  return Build(FMeshEdgeTable::FindOrBuild(StaticMesh, LODIndex));
+	                                  });
+}
+
+void FMeshVertexKDTree::RemoveUnusedTrees()
+{
+	GetTreeCache().RemoveUnused();
+}
+
+TSharedPtr<const FMeshVertexKDTree, ESPMode::ThreadSafe> FMeshVertexKDTree::Build(
+	const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable, const FMeshEdgePosePtr& Pose)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FMeshVertexKDTree::Build);
+
+	if (!EdgeTable.IsValid())
+	{
+		return nullptr;
+	}
+
+	TSharedPtr<FMeshVertexKDTree, ESPMode::ThreadSafe> Tree = MakeShared<FMeshVertexKDTree, ESPMode::ThreadSafe>();
+	Tree->EdgeTable = EdgeTable;
+	Tree->Pose = Pose;
+
+	const TArray<FVector3f>& Positions = Tree->GetPositions();
+	Tree->Order.SetNumUninitialized(Positions.Num());
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		Tree->Order[Index] = Index;
+	}
+	Tree->SplitAxes.SetNumZeroed(Positions.Num());
+
+	// Every range is split at its middle along the longest axis of its bounds
+	TArray<TPair<int32, int32>> RangeStack;
+	RangeStack.Emplace(0, Positions.Num());
+	while (RangeStack.Num() > 0)
+	{
+		const TPair<int32, int32> Range = RangeStack.Pop(false);
+		const int32 First = Range.Key;
+		const int32 Last = Range.Value;
+		if (Last - First <= 0)
+		{
+			continue;
+		}
+
+		FBox3f Bounds(ForceInit);
+		for (int32 Index = First; Index < Last; ++Index)
+		{
+			Bounds += Positions[Tree->Order[Index]];
+		}
+		const FVector3f Extent = Bounds.GetExtent();
+		const int32 Axis = Extent.X >= Extent.Y && Extent.X >= Extent.Z ? 0 : (Extent.Y >= Extent.Z ? 1 : 2);
+
+		const int32 Middle = (First + Last) / 2;
+		SelectNth(Tree->Order, First, Last, Middle, Positions, Axis);
+		Tree->SplitAxes[Middle] = static_cast<uint8>(Axis);
+		RangeStack.Emplace(First, Middle);
+		RangeStack.Emplace(Middle + 1, Last);
+	}
+
+	return Tree;
+}
+
+void FMeshVertexKDTree::FindNearest(const FVector3f& Position, int32 K, TArray<FMeshVertexNeighbor>& OutNeighbors,
+                                    const FVector3f& Scale, int32 ExcludedVertex, float MaxDistanceSquared) const
+{
+	OutNeighbors.Reset();
+	if (K <= 0 || Order.Num() == 0)
+	{
+		return;
+	}
+
+	OutNeighbors.Reserve(K + 1);
+	FQuery Query{Position, Scale * Scale, K, ExcludedVertex, OutNeighbors, MaxDistanceSquared};
+	FindNearestInRange(Query, 0, Order.Num());
+}
+
+void FMeshVertexKDTree::FindNearestInRange(FQuery& Query, int32 First, int32 Last) const
+{
+	if (Last - First <= 0)
+	{
+		return;
+	}
+
+	const int32 Middle = (First + Last) / 2;
+	const int32 VertexIndex = Order[Middle];
+	const FVector3f& VertexPosition = GetPositions()[VertexIndex];
+	if (VertexIndex != Query.ExcludedVertex)
+	{
+		const FVector3f Delta = VertexPosition - Query.Position;
+		const float DistanceSquared = FVector3f::DotProduct(Delta * Delta, Query.ScaleSquared);
+		if (DistanceSquared < Query.GetBoundSquared())
+		{
+			Query.Add(VertexIndex, DistanceSquared);
+		}
+	}
+
+	// Visit the side of the split containing the query first, the other side only if it can still be closer
+	const int32 Axis = SplitAxes[Middle];
+	const float PlaneDelta = Query.Position[Axis] - VertexPosition[Axis];
+	const bool bLeftFirst = PlaneDelta < 0.f;
+	FindNearestInRange(Query, bLeftFirst ? First : Middle + 1, bLeftFirst ? Middle : Last);
+	if (FMath::Square(PlaneDelta) * Query.ScaleSquared[Axis] < Query.GetBoundSquared())
+	{
+		FindNearestInRange(Query, bLeftFirst ? Middle + 1 : First, bLeftFirst ? Last : Middle);
+	}
+}
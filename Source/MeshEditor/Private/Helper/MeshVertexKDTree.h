@@ -0,0 +1,71 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Helper/MeshEdgeTable.h"
+
+class UStaticMesh;
+
+/** Vertex found by FMeshVertexKDTree::FindNearest */
+struct FMeshVertexNeighbor
+{
+	/** Welded vertex index in the edge table */
+	int32 VertexIndex{INDEX_NONE};
+	/** Squared distance to the query position, in the scaled space of the query */
+	float DistanceSquared{0.f};
+};
+
+/**
+ * Balanced k-d tree over the welded vertices of one static mesh LOD, in mesh local space. The tree is implicit: the
+ * vertex at the middle of every range of Order splits that range along SplitAxes at the same position.
+ */
+class FMeshVertexKDTree
+{
+public:
+	/**
+	* @return The shared tree of the mesh LOD, built on first use and cached until the render data changes
+	*/
+	static TSharedPtr<const FMeshVertexKDTree, ESPMode::ThreadSafe> FindOrBuild(const UStaticMesh* StaticMesh,
+	                                                                           int32 LODIndex);
+
+	/** Releases cached trees of meshes that no longer exist or that nothing references anymore */
+	static void RemoveUnusedTrees();
+
+	/** @param Pose Pose of the edge table to place the vertices at, null for the positions of the table itself */
+	static TSharedPtr<const FMeshVertexKDTree, ESPMode::ThreadSafe> Build(
+		const TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe>& EdgeTable,
+		const FMeshEdgePosePtr& Pose = nullptr);
+
+	/**
+	* Finds the K vertices closest to Position, nearest first. Distances are measured after scaling both positions by
+	* Scale, which gives world distances for the local position of a component and its absolute 3D scale.
+	* @param ExcludedVertex Vertex that is never returned, usually the one the query position comes from
+	* @param MaxDistanceSquared Vertices further than this are ignored
+	*/
+	void FindNearest(const FVector3f& Position, int32 K, TArray<FMeshVertexNeighbor>& OutNeighbors,
+	                 const FVector3f& Scale = FVector3f::OneVector, int32 ExcludedVertex = INDEX_NONE,
+	                 float MaxDistanceSquared = BIG_NUMBER) const;
+
+	const FMeshEdgeTable& GetEdgeTable() const
+	{
+		return *EdgeTable;
+	}
+
+private:
+	struct FQuery;
+
+	void FindNearestInRange(FQuery& Query, int32 First, int32 Last) const;
+
+	const TArray<FVector3f>& GetPositions() const
+	{
+		return Pose.IsValid() ? Pose->Positions : EdgeTable->Positions;
+	}
+
+	TSharedPtr<const FMeshEdgeTable, ESPMode::ThreadSafe> EdgeTable;
+	FMeshEdgePosePtr Pose;
+	/** Welded vertex indices in tree order */
+	TArray<int32> Order;
+	/** Split axis of the node stored at the same position of Order */
+	TArray<uint8> SplitAxes;
+};
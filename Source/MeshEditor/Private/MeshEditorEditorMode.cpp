@@ -6,39 +6,30 @@
 #include "InteractiveToolManager.h"
 #include "MeshEditorEditorModeCommands.h"
 #include "MeshEditorSettings.h"
+#include "MeshEditorStats.h"
 #include "UnrealEd.h"
 #include "Algo/Copy.h"
+#include "UDynamicMesh.h"
+#include "Components/DynamicMeshComponent.h"
+#include "Components/SkinnedMeshComponent.h"
 #include "Dragger/AxisDragger.h"
 #include "Tools/MeshEditorSimpleTool.h"
 #include "Tools/MeshEditorInteractiveTool.h"
+#include "Helper/MeshBVH.h"
 #include "Helper/MeshDataIterators.h"
+#include "Helper/MeshEdgeTable.h"
+#include "Helper/MeshSource.h"
+#include "Helper/MeshTopology.h"
+#include "Helper/MeshVertexKDTree.h"
+#include "Overlay/MeshEdgeOverlayComponent.h"
 
 #define LOCTEXT_NAMESPACE "MeshEditorEditorMode"
 
-struct HMeshEdgeProxy : public HHitProxy
+namespace
 {
-	DECLARE_HIT_PROXY()
-
-	HMeshEdgeProxy(FVector InPosition, AActor* InActor)
-		: HHitProxy(HPP_UI), RefVector(InPosition), RefActor(InActor)
-	{
-	}
-
-	HMeshEdgeProxy(FVector InFirstEndpoint, FVector InSecondEndpoint, AActor* InActor)
-		: HHitProxy(HPP_UI), FirstRefVector(InFirstEndpoint), SecondRefVector(InSecondEndpoint),
-		  RefActor(InActor)
-	{
-	}
-
-	AActor* RefActor;
-	FVector RefVector;
-
-	// edge info
-	FVector FirstRefVector;
-	FVector SecondRefVector;
-};
-
-IMPLEMENT_HIT_PROXY(HMeshEdgeProxy, HHitProxy);
+	/** Fraction of the depth of the surface under the cursor an edge may lie behind it and still be picked */
+	constexpr double PickDepthTolerance = 0.05;
+}
 
 const FEditorModeID FMeshEditorEditorMode::EM_MeshEditorEditorModeId = TEXT("EM_MeshEditorEditorMode");
 
@@ -89,37 +80,69 @@ void FMeshEditorEditorMode::Enter()
 		OnCollectingDataFinished.BindRaw(this, &FMeshEditorEditorMode::CollectingMeshDataFinished);
 	}
 
-	GetWorld()->GetTimerManager().SetTimer(CollectVerticesTimerHandle,
-	                                       FTimerDelegate::CreateRaw(
-		                                       this, &FMeshEditorEditorMode::AsyncCollectMeshData), 0.2f,
-	                                       false);
-	GetWorld()->GetTimerManager().SetTimer(InvalidateHitProxiesTimerHandle,
-	                                       FTimerDelegate::CreateRaw(
-		                                       this, &FMeshEditorEditorMode::InvalidateHitProxies), 0.3f, true);
 	UpdateInitialSelection();
+
+	UpdateScreenEdgesRequired();
+
+	ObjectPropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddRaw(
+		this, &FMeshEditorEditorMode::OnObjectPropertyChanged);
+	RefreshTrackedComponents();
+
+	EdgeOverlay = NewObject<UMeshEdgeOverlayComponent>(GetTransientPackage());
+	EdgeOverlay->AddToRoot();
+	EdgeOverlay->RegisterComponentWithWorld(GetWorld());
+	EdgeOverlay->SetWorldData(CapturedEdgeData.Read().WorldData);
 }
 
 
 void FMeshEditorEditorMode::Exit()
 {
 	bIsModeOn = false;
+	bCursorInViewport = false;
+	bScreenEdgesRequired = false;
 
-	if (CollectVerticesTimerHandle.IsValid())
-	{
-		GetWorld()->GetTimerManager().ClearTimer(CollectVerticesTimerHandle);
-	}
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(ObjectPropertyChangedHandle);
+	UntrackComponents();
+	HoverPickView.Reset();
 
-	if (InvalidateHitProxiesTimerHandle.IsValid())
+	if (EdgeOverlay)
 	{
-		GetWorld()->GetTimerManager().ClearTimer(InvalidateHitProxiesTimerHandle);
+		EdgeOverlay->DestroyComponent();
+		EdgeOverlay->RemoveFromRoot();
+		EdgeOverlay = nullptr;
 	}
 
 	CurrentMeshData->EraseSelection();
 	delete AxisDragger;
 
+	// A collection still in flight owns the write buffer, CollectingMeshDataFinished releases after it
+	if (!bDataCollectionInProgress)
+	{
+		ReleaseCollectedData();
+	}
+
 	FEdMode::Exit();
 }
 
+void FMeshEditorEditorMode::ReleaseCollectedData()
+{
+	// Every buffer becomes the write buffer once as it is written and published three times
+	for (int32 BufferIndex = 0; BufferIndex < 3; ++BufferIndex)
+	{
+		CapturedEdgeData.GetWriteBuffer() = FMeshEdgeSnapshot();
+		CapturedEdgeData.SwapWriteBuffers();
+		CapturedEdgeData.SwapReadBuffers();
+	}
+	EdgeCollector.Reset();
+	FMeshSources::Reset();
+
+	// BVHs, trees and topologies hold their edge table, so they go first
+	FMeshBVH::RemoveUnusedBVHs();
+	FMeshVertexKDTree::RemoveUnusedTrees();
+	FMeshTopology::RemoveUnusedTopologies();
+	FMeshEdgeTable::RemoveUnusedTables();
+}
+
 FVector BlendPositions(FVector Pos1, FVector Pos2, float factor = 1.0)
 {
 	return Pos1;
@@ -131,25 +154,39 @@ bool FMeshEditorEditorMode::HandleClick(FEditorViewportClient* InViewportClient,
 	bool bEdgeClickHandle{false};
 
 #ifdef WITH_EDITOR
-	if (HitProxy)
+	const bool bIsLeftMouseButtonClick = (Click.GetKey() == EKeys::LeftMouseButton);
+	if (bIsLeftMouseButtonClick)
 	{
-		const bool bIsLeftMouseButtonClick = (Click.GetKey() == EKeys::LeftMouseButton);
-		if (bIsLeftMouseButtonClick && HitProxy->IsA(HMeshEdgeProxy::StaticGetType()))
+		FMeshEdgePickResult PickedEdge;
+		FMeshVertexPickResult PickedVertex;
+		PickAt(Click.GetView(), FVector2D{Click.GetClickPos()} / DPIScale, PickedEdge, PickedVertex);
+		if (PickedEdge.IsValid() || PickedVertex.IsValid())
 		{
-			const auto MeshEdgeHitProxy = static_cast<HMeshEdgeProxy*>(HitProxy);
-			FVector SelectedVertex = BlendPositions(MeshEdgeHitProxy->FirstRefVector,
-			                                        MeshEdgeHitProxy->SecondRefVector);
-
-			TArray<AActor*> SelectedActors;
-			USelection* CurrentEditorSelection = GEditor->GetSelectedActors();
-			CurrentEditorSelection->GetSelectedObjects<AActor>(SelectedActors);
+			// Double clicking an edge selects its edge loop, or its edge ring while shift is held
+			if (Click.GetEvent() == IE_DoubleClick && PickedEdge.IsValid() &&
+				SelectEdgeLoop(PickedEdge.EdgeIndex, Click.IsShiftDown()))
+			{
+				return true;
+			}
+			ClearEdgeLoop();
 
-			const FTransform NewPivotTransform = FTransform(SelectedVertex);
-			for (AActor* Actor : SelectedActors)
+			// Vertices near the cursor take precedence over the edges running into them
+			const FMeshEdgeWorldData& WorldData = *CapturedEdgeData.Read().WorldData;
+			FVector SelectedVertex;
+			if (PickedVertex.IsValid())
 			{
-				Actor->SetPivotOffset(NewPivotTransform.GetRelativeTransform(Actor->GetActorTransform()).GetLocation());
-				GUnrealEd->UpdatePivotLocationForSelection(true);
+				const FMeshEdgeOwner& Owner = WorldData.Owners[WorldData.FindOwnerOfVertex(PickedVertex.VertexIndex)];
+				SelectedVertex = WorldData.GetWorldPosition(Owner, PickedVertex.VertexIndex);
 			}
+			else
+			{
+				const FMeshEdgeOwner& Owner = WorldData.Owners[WorldData.FindOwnerOfEdge(PickedEdge.EdgeIndex)];
+				const FMeshEdge& Edge = WorldData.Edges[PickedEdge.EdgeIndex];
+				SelectedVertex = BlendPositions(WorldData.GetWorldPosition(Owner, Edge.FirstIndex),
+				                                WorldData.GetWorldPosition(Owner, Edge.SecondIndex));
+			}
+
+			SetPivotOfSelectedActors(SelectedVertex);
 			bEdgeClickHandle = true;
 		}
 	}
@@ -158,6 +195,117 @@ bool FMeshEditorEditorMode::HandleClick(FEditorViewportClient* InViewportClient,
 	return bEdgeClickHandle;
 }
 
+bool FMeshEditorEditorMode::SelectEdgeLoop(int32 EdgeIndex, bool bRing)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MeshEditor_SelectEdgeLoop);
+
+	const FMeshEdgeWorldData* WorldData = CapturedEdgeData.Read().WorldData.Get();
+	if (!WorldData || !WorldData->Edges.IsValidIndex(EdgeIndex))
+	{
+		return false;
+	}
+	const FMeshEdgeOwner& Owner = WorldData->Owners[WorldData->FindOwnerOfEdge(EdgeIndex)];
+	if (!Owner.EdgeTable.IsValid())
+	{
+		return false;
+	}
+
+	TSharedPtr<const FMeshTopology, ESPMode::ThreadSafe> Topology;
+	if (Owner.MeshSource.IsValid())
+	{
+		if (LoopTopologySource != Owner.MeshSource)
+		{
+			LoopTopologySource = Owner.MeshSource;
+			LoopTopology = FMeshTopology::Build(*Owner.MeshSource, Owner.EdgeTable);
+		}
+		Topology = LoopTopology;
+	}
+	else
+	{
+		Topology = FMeshTopology::FindOrBuild(Owner.StaticMesh, Owner.LODIndex);
+	}
+
+	// Topology vertices are those of the edge table the owner was collected from, unless the render data changed since
+	if (!Topology.IsValid() || Topology->EdgeTable != Owner.EdgeTable)
+	{
+		return false;
+	}
+
+	const FMeshEdge& Edge = WorldData->Edges[EdgeIndex];
+	const int32 First = int32(Edge.FirstIndex) - Owner.FirstVertex;
+	const int32 Second = int32(Edge.SecondIndex) - Owner.FirstVertex;
+	int32 HalfEdge = Topology->FindHalfEdge(First, Second);
+	if (HalfEdge == INDEX_NONE)
+	{
+		HalfEdge = Topology->FindHalfEdge(Second, First);
+	}
+	if (HalfEdge == INDEX_NONE)
+	{
+		return false;
+	}
+
+	TArray<int32> HalfEdges;
+	const bool bClosed = bRing
+		                     ? Topology->FindEdgeRing(HalfEdge, HalfEdges)
+		                     : Topology->FindEdgeLoop(HalfEdge, HalfEdges);
+
+	// Positions come from the vertex pool, which holds the pose skinned meshes were collected in
+	SelectedLoopPositions.Reset(HalfEdges.Num() * 2);
+	FVector Center{FVector::ZeroVector};
+	FVector Axis{FVector::ZeroVector};
+	for (const int32 LoopHalfEdge : HalfEdges)
+	{
+		const FVector Start = WorldData->GetWorldPosition(Owner, Owner.FirstVertex + Topology->GetOrigin(LoopHalfEdge));
+		const FVector End = WorldData->GetWorldPosition(Owner,
+		                                                Owner.FirstVertex + Topology->GetDestination(LoopHalfEdge));
+		SelectedLoopPositions.Add(Start);
+		SelectedLoopPositions.Add(End);
+		Center += (Start + End) * 0.5;
+
+		if (bRing)
+		{
+			// Ring edges point either way, they are summed facing the same side
+			const FVector Direction = (End - Start).GetSafeNormal();
+			Axis += FVector::DotProduct(Axis, Direction) < 0.0 ? -Direction : Direction;
+		}
+		else
+		{
+			// Newell's method around the first vertex, which also closes open loops
+			const FVector& Pivot = SelectedLoopPositions[0];
+			Axis += FVector::CrossProduct(Start - Pivot, End - Pivot);
+		}
+	}
+
+	SelectedLoopAxis = Axis.GetSafeNormal();
+	SelectedLoopComponent = Owner.ComponentKey;
+	SetPivotOfSelectedActors(Center / HalfEdges.Num());
+
+	UE_LOG(LogMeshEditor, Verbose, TEXT("Selected %s edge %s of %d edges"), bClosed ? TEXT("closed") : TEXT("open"),
+	       bRing ? TEXT("ring") : TEXT("loop"), HalfEdges.Num());
+	return true;
+}
+
+void FMeshEditorEditorMode::ClearEdgeLoop()
+{
+	SelectedLoopPositions.Reset();
+	SelectedLoopAxis = FVector::ZeroVector;
+	SelectedLoopComponent = TObjectKey<UPrimitiveComponent>();
+}
+
+void FMeshEditorEditorMode::SetPivotOfSelectedActors(const FVector& Pivot)
+{
+	TArray<AActor*> SelectedActors;
+	USelection* CurrentEditorSelection = GEditor->GetSelectedActors();
+	CurrentEditorSelection->GetSelectedObjects<AActor>(SelectedActors);
+
+	const FTransform NewPivotTransform = FTransform(Pivot);
+	for (AActor* Actor : SelectedActors)
+	{
+		Actor->SetPivotOffset(NewPivotTransform.GetRelativeTransform(Actor->GetActorTransform()).GetLocation());
+		GUnrealEd->UpdatePivotLocationForSelection(true);
+	}
+}
+
 float ComputeScaleFactor(FVector& Base, FVector& DragDelta, int Axis)
 {
 	float Result = 1.0;
@@ -176,6 +324,8 @@ float ComputeScaleFactor(FVector& Base, FVector& DragDelta, int Axis)
 bool FMeshEditorEditorMode::HandleAxisWidgetDelta(FEditorViewportClient* InViewportClient, const FVector& NotUsed0,
                                                   const FRotator& NotUsed1, const FVector& NotUsed2)
 {
+	SCOPE_CYCLE_COUNTER(STAT_MeshEditor_AxisWidgetDelta);
+
 	if (AxisDragger->GetCurrentAxisType() == EAxisList::None)
 	{
 		return false;
@@ -249,6 +399,214 @@ bool FMeshEditorEditorMode::HandleAxisWidgetDelta(FEditorViewportClient* InViewp
 void FMeshEditorEditorMode::ActorSelectionChangeNotify()
 {
 	UpdateSelection();
+	RefreshTrackedComponents();
+}
+
+void FMeshEditorEditorMode::RefreshTrackedComponents()
+{
+	UntrackComponents();
+
+	TArray<AActor*> SelectedActors{};
+	USelection* CurrentEditorSelection = GEditor->GetSelectedActors();
+	CurrentEditorSelection->GetSelectedObjects<AActor>(SelectedActors);
+
+	for (const AActor* SelectedActor : SelectedActors)
+	{
+		TInlineComponentArray<UPrimitiveComponent*> MeshComponents;
+		SelectedActor->GetComponents<UPrimitiveComponent>(MeshComponents);
+
+		for (UPrimitiveComponent* MeshComponent : MeshComponents)
+		{
+			if (!IsValid(MeshComponent))
+			{
+				continue;
+			}
+
+			if (const UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(MeshComponent))
+			{
+				// Skip sky sphere
+				const UStaticMesh* StaticMesh = StaticMeshComponent->GetStaticMesh();
+				if (!StaticMesh || StaticMesh->GetName().Contains("SkySphere"))
+				{
+					continue;
+				}
+			}
+			else if (!FMeshSources::IsSupported(MeshComponent))
+			{
+				continue;
+			}
+
+			const AActor* Owner = MeshComponent->GetOwner();
+			if ((Owner != nullptr && Owner->IsSelected()) || MeshComponent->IsSelected())
+			{
+				MeshComponent->TransformUpdated.AddRaw(this, &FMeshEditorEditorMode::OnComponentTransformUpdated);
+				if (const UDynamicMeshComponent* DynamicComponent = Cast<UDynamicMeshComponent>(MeshComponent))
+				{
+					if (UDynamicMesh* DynamicMesh = DynamicComponent->GetDynamicMesh())
+					{
+						DynamicMesh->OnMeshChanged().AddRaw(this, &FMeshEditorEditorMode::OnDynamicMeshChanged);
+					}
+				}
+				TrackedComponents.Add(MeshComponent);
+			}
+		}
+	}
+
+	bCollectionRequested = true;
+}
+
+void FMeshEditorEditorMode::UntrackComponents()
+{
+	for (const TWeakObjectPtr<UPrimitiveComponent>& TrackedComponent : TrackedComponents)
+	{
+		if (UPrimitiveComponent* MeshComponent = TrackedComponent.Get())
+		{
+			MeshComponent->TransformUpdated.RemoveAll(this);
+			if (const UDynamicMeshComponent* DynamicComponent = Cast<UDynamicMeshComponent>(MeshComponent))
+			{
+				if (UDynamicMesh* DynamicMesh = DynamicComponent->GetDynamicMesh())
+				{
+					DynamicMesh->OnMeshChanged().RemoveAll(this);
+				}
+			}
+			FMeshSources::Invalidate(MeshComponent);
+		}
+	}
+	TrackedComponents.Reset();
+	DirtyComponents.Reset();
+	EdgeLODs.Reset();
+	ClearEdgeLoop();
+	LoopTopologySource.Reset();
+	LoopTopology.Reset();
+}
+
+void FMeshEditorEditorMode::OnComponentTransformUpdated(USceneComponent* UpdatedComponent,
+                                                        EUpdateTransformFlags UpdateTransformFlags,
+                                                        ETeleportType Teleport)
+{
+	if (UPrimitiveComponent* MeshComponent = Cast<UPrimitiveComponent>(UpdatedComponent))
+	{
+		DirtyComponents.Add(MeshComponent);
+	}
+}
+
+void FMeshEditorEditorMode::OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
+{
+	if (EdgeOverlay && Object == UMeshEditorSettings::Get())
+	{
+		EdgeOverlay->RefreshAppearance();
+		bViewDirty = true;
+		HoverPickView.Reset();
+		UpdateScreenEdgesRequired();
+
+		// Other edge classes change which edges are collected, not just how they look
+		const FName PropertyName = PropertyChangedEvent.GetPropertyName();
+		if (PropertyName == GET_MEMBER_NAME_CHECKED(UMeshEditorSettings, MeshEdgeClasses) ||
+			PropertyName == GET_MEMBER_NAME_CHECKED(UMeshEditorSettings, MeshEdgeCreaseAngle))
+		{
+			bCollectionRequested = true;
+		}
+		return;
+	}
+
+	// Catches mesh assignments on tracked components as well as rebuilds of the meshes they use
+	for (const TWeakObjectPtr<UPrimitiveComponent>& TrackedComponent : TrackedComponents)
+	{
+		UPrimitiveComponent* MeshComponent = TrackedComponent.Get();
+		if (!MeshComponent)
+		{
+			continue;
+		}
+
+		const UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(MeshComponent);
+		const USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(MeshComponent);
+		if (MeshComponent != Object && (!StaticMeshComponent || StaticMeshComponent->GetStaticMesh() != Object) &&
+			(!SkinnedComponent || SkinnedComponent->GetSkinnedAsset() != Object))
+		{
+			continue;
+		}
+
+		// The next collection extracts skinned and dynamic meshes again
+		if (!StaticMeshComponent)
+		{
+			FMeshSources::Invalidate(MeshComponent);
+		}
+		DirtyComponents.Add(MeshComponent);
+	}
+}
+
+void FMeshEditorEditorMode::OnDynamicMeshChanged(UDynamicMesh* DynamicMesh, FDynamicMeshChangeInfo ChangeInfo)
+{
+	for (const TWeakObjectPtr<UPrimitiveComponent>& TrackedComponent : TrackedComponents)
+	{
+		const UDynamicMeshComponent* DynamicComponent = Cast<UDynamicMeshComponent>(TrackedComponent.Get());
+		if (DynamicComponent && DynamicComponent->GetDynamicMesh() == DynamicMesh)
+		{
+			FMeshSources::Invalidate(DynamicComponent);
+			DirtyComponents.Add(DynamicComponent);
+		}
+	}
+}
+
+void FMeshEditorEditorMode::UpdateSkinnedComponents()
+{
+	for (const TWeakObjectPtr<UPrimitiveComponent>& TrackedComponent : TrackedComponents)
+	{
+		USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(TrackedComponent.Get());
+		if (SkinnedComponent && FMeshSources::HasPoseChanged(SkinnedComponent, EdgeLODs.FindRef(SkinnedComponent)))
+		{
+			DirtyComponents.Add(SkinnedComponent);
+		}
+	}
+}
+
+bool FMeshEditorEditorMode::HasPendingCollection() const
+{
+	return bCollectionRequested || DirtyComponents.Num() > 0 || (bViewDirty && bScreenEdgesRequired);
+}
+
+void FMeshEditorEditorMode::UpdateEdgeLODs()
+{
+	const UMeshEditorSettings* Settings = UMeshEditorSettings::Get();
+	TMap<TObjectKey<UPrimitiveComponent>, int32> PreviousLODs = MoveTemp(EdgeLODs);
+	EdgeLODs.Reset();
+	for (const TWeakObjectPtr<UPrimitiveComponent>& TrackedComponent : TrackedComponents)
+	{
+		UPrimitiveComponent* PrimitiveComponent = TrackedComponent.Get();
+		if (!IsValid(PrimitiveComponent))
+		{
+			continue;
+		}
+
+		// Skinned meshes follow the LOD the renderer predicted for them, dynamic meshes have a single LOD
+		int32 LODIndex = 0;
+		UStaticMeshComponent* MeshComponent = Cast<UStaticMeshComponent>(PrimitiveComponent);
+		if (const USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(PrimitiveComponent))
+		{
+			LODIndex = SkinnedComponent->GetPredictedLODLevel();
+		}
+		else if (MeshComponent && LastViewProjection.IsSet())
+		{
+			switch (Settings->MeshEdgeLODSelection)
+			{
+			case EMeshEdgeLODSelection::Rendered:
+				LODIndex = FMeshDataIterators::GetRenderedLOD(MeshComponent, *LastViewProjection);
+				break;
+			case EMeshEdgeLODSelection::EdgeSpacing:
+			default:
+				LODIndex = FMeshEdgeCollector::SelectLOD(MeshComponent->GetStaticMesh(), MeshComponent->Bounds,
+				                                         *LastViewProjection, Settings->MeshEdgeLODPixelThreshold);
+				break;
+			}
+		}
+		EdgeLODs.Add(PrimitiveComponent, LODIndex);
+
+		const int32* PreviousLOD = PreviousLODs.Find(PrimitiveComponent);
+		if (PreviousLOD && *PreviousLOD != LODIndex)
+		{
+			DirtyComponents.Add(PrimitiveComponent);
+		}
+	}
 }
 
 void UMeshGeoData::EraseSelection()
@@ -268,9 +626,34 @@ void UMeshGeoData::SaveStatus()
 	Modify();
 }
 
+bool FMeshEditorEditorMode::MouseEnter(FEditorViewportClient* ViewportClient, FViewport* Viewport, int32 x, int32 y)
+{
+	bCursorInViewport = true;
+	UpdateScreenEdgesRequired();
+	return FEdMode::MouseEnter(ViewportClient, Viewport, x, y);
+}
+
+bool FMeshEditorEditorMode::MouseLeave(FEditorViewportClient* ViewportClient, FViewport* Viewport)
+{
+	bCursorInViewport = false;
+	UpdateScreenEdgesRequired();
+	return FEdMode::MouseLeave(ViewportClient, Viewport);
+}
+
+void FMeshEditorEditorMode::UpdateScreenEdgesRequired()
+{
+	// Picking falls back to world space rays without projected edges, silhouettes can only be found on screen
+	const bool bRequired = bCursorInViewport || UMeshEditorSettings::Get()->bShowSilhouetteEdgesOnly;
+	if (bRequired != bScreenEdgesRequired)
+	{
+		bScreenEdgesRequired = bRequired;
+		bViewDirty = true;
+	}
+}
+
 bool FMeshEditorEditorMode::StartTracking(FEditorViewportClient* InViewportClient, FViewport* InViewport)
 {
-	UE_LOG(LogTemp, Display, TEXT("StartTracking. "));
+	UE_LOG(LogMeshEditor, VeryVerbose, TEXT("StartTracking"));
 	// DragTransaction.Begin(LOCTEXT("MeshDragTransaction", "Mesh drag transaction"));
 
 	if (AxisDragger != nullptr && AxisDragger->GetCurrentAxisType() != EAxisList::Type::None)
@@ -282,7 +665,7 @@ bool FMeshEditorEditorMode::StartTracking(FEditorViewportClient* InViewportClien
 
 bool FMeshEditorEditorMode::EndTracking(FEditorViewportClient* InViewportClient, FViewport* InViewport)
 {
-	UE_LOG(LogTemp, Display, TEXT("EndTracking. "));
+	UE_LOG(LogMeshEditor, VeryVerbose, TEXT("EndTracking"));
 
 	if (bIsTracking)
 	{
@@ -346,7 +729,7 @@ void FMeshEditorEditorMode::UpdateSelection()
 bool FMeshEditorEditorMode::InputKey(FEditorViewportClient* ViewportClient, FViewport* Viewport, FKey Key,
                                      EInputEvent Event)
 {
-	UE_LOG(LogTemp, Display, TEXT("InputKey. "));
+	UE_LOG(LogMeshEditor, VeryVerbose, TEXT("InputKey %s"), *Key.ToString());
 
 	const int32 HitX = Viewport->GetMouseX();
 	const int32 HitY = Viewport->GetMouseY();
@@ -357,14 +740,14 @@ bool FMeshEditorEditorMode::InputKey(FEditorViewportClient* ViewportClient, FVie
 
 		if (Event == IE_Pressed)
 		{
-			UE_LOG(LogTemp, Display, TEXT("InputKey - IE_Pressed. "));
+			UE_LOG(LogMeshEditor, Verbose, TEXT("Axis dragger pressed"));
 			AxisDragger->SetCurrentAxis(AWProxy->Axis, AWProxy->bFlipped);
 			AxisDragger->ResetInitialTranslationOffset();
 			ViewportClient->SetCurrentWidgetAxis(EAxisList::Type::None);
 		}
 		else if (Event == IE_Released)
 		{
-			UE_LOG(LogTemp, Display, TEXT("InputKey - IE_Released. "));
+			UE_LOG(LogMeshEditor, Verbose, TEXT("Axis dragger released"));
 			AxisDragger->SetCurrentAxis(EAxisList::None);
 		}
 	}
@@ -374,7 +757,7 @@ bool FMeshEditorEditorMode::InputKey(FEditorViewportClient* ViewportClient, FVie
 bool FMeshEditorEditorMode::InputDelta(FEditorViewportClient* InViewportClient, FViewport* InViewport, FVector& InDrag,
                                        FRotator& InRot, FVector& InScale)
 {
-	UE_LOG(LogTemp, Display, TEXT("InputDelta. "));
+	UE_LOG(LogMeshEditor, VeryVerbose, TEXT("InputDelta"));
 	if (HandleAxisWidgetDelta(InViewportClient, InDrag, InRot, InScale))
 	{
 		return true;
@@ -400,6 +783,28 @@ void FMeshEditorEditorMode::Tick(FEditorViewportClient* ViewportClient, float De
 			FTimerDelegate::CreateRaw(this, &FMeshEditorEditorMode::EraseDroppingPreview));
 	}
 	bPreviousDroppingPreview = bCurrentDroppingPreview;
+
+	// Pick up the latest published edges, the overlay only rebuilds when the world data or the silhouette changed
+	if (CapturedEdgeData.IsDirty())
+	{
+		CapturedEdgeData.SwapReadBuffers();
+		++SnapshotSerial;
+	}
+	if (EdgeOverlay)
+	{
+		const FMeshEdgeSnapshot& Snapshot = CapturedEdgeData.Read();
+		EdgeOverlay->SetWorldData(Snapshot.WorldData, Snapshot.SilhouetteEdges, Snapshot.ScreenViewProjection.ViewKey);
+		EdgeOverlay->SetVisibility(!bCurrentDroppingPreview);
+	}
+
+	if (bIsModeOn && !bDataCollectionInProgress)
+	{
+		UpdateSkinnedComponents();
+		if (HasPendingCollection())
+		{
+			AsyncCollectMeshData();
+		}
+	}
 }
 
 FVector FMeshEditorEditorMode::GetWidgetLocation() const
@@ -415,6 +820,21 @@ FVector FMeshEditorEditorMode::GetWidgetLocation() const
 	return FEdMode::GetWidgetLocation();
 }
 
+bool FMeshEditorEditorMode::GetCustomDrawingCoordinateSystem(FMatrix& InMatrix, void* InData)
+{
+	if (SelectedLoopPositions.Num() == 0 || SelectedLoopAxis.IsZero())
+	{
+		return false;
+	}
+	InMatrix = FRotationMatrix::MakeFromZ(SelectedLoopAxis);
+	return true;
+}
+
+bool FMeshEditorEditorMode::GetCustomInputCoordinateSystem(FMatrix& InMatrix, void* InData)
+{
+	return GetCustomDrawingCoordinateSystem(InMatrix, InData);
+}
+
 FVector2D FMeshEditorEditorMode::GetMouseVector2D()
 {
 	return FVector2D{
@@ -422,24 +842,158 @@ FVector2D FMeshEditorEditorMode::GetMouseVector2D()
 	};
 }
 
+void FMeshEditorEditorMode::PickAt(const FSceneView* View, const FVector2D& ScreenPosition,
+                                   FMeshEdgePickResult& OutEdge, FMeshVertexPickResult& OutVertex)
+{
+	SCOPE_CYCLE_COUNTER(STAT_MeshEditor_Pick);
+
+	OutEdge = FMeshEdgePickResult{};
+	OutVertex = FMeshVertexPickResult{};
+
+	const FMeshEdgeSnapshot& Snapshot = CapturedEdgeData.Read();
+	const FMeshEdgeWorldData* WorldData = Snapshot.WorldData.Get();
+	if (!WorldData || !LastViewProjection.IsSet())
+	{
+		return;
+	}
+
+	const UMeshEditorSettings* Settings{UMeshEditorSettings::Get()};
+
+	// Edges behind the surface under the cursor are occluded
+	FVector RayOrigin;
+	FVector RayDirection;
+	View->DeprojectFVector2D(ScreenPosition * DPIScale, RayOrigin, RayDirection);
+	FMeshRayHit SurfaceHit;
+	const bool bHitSurface = WorldData->RayCast(RayOrigin, RayDirection, HALF_WORLD_MAX, SurfaceHit);
+
+	if (Snapshot.HasScreenPositions() && Snapshot.ScreenViewProjection.Equals(*LastViewProjection))
+	{
+		float MaxDepth = BIG_NUMBER;
+		if (bHitSurface && View->IsPerspectiveProjection())
+		{
+			MaxDepth = static_cast<float>(LastViewProjection->GetDepth(SurfaceHit.Position) *
+				(1.0 + PickDepthTolerance)) + Settings->MeshEdgeSurfaceOffset;
+		}
+
+		OutEdge = Snapshot.FindNearestEdge(ScreenPosition, Settings->MeshEdgePickRadius, MaxDepth);
+		OutVertex = Snapshot.FindNearestVertex(ScreenPosition, Settings->MeshEdgePickRadius, MaxDepth);
+		return;
+	}
+
+	// The screen positions lag behind the view, search around the cursor ray near the surface instead
+	if (!bHitSurface)
+	{
+		return;
+	}
+
+	// Clip space W is the view depth in perspective and one in orthographic views, both scale the pixel size
+	const double SurfaceDepth = LastViewProjection->GetDepth(SurfaceHit.Position);
+	const double WorldUnitsPerPixel = 2.0 * SurfaceDepth * DPIScale /
+		FMath::Max(View->ViewMatrices.GetProjectionMatrix().M[0][0] * View->UnscaledViewRect.Width(), SMALL_NUMBER);
+	const double WorldRadius = Settings->MeshEdgePickRadius * WorldUnitsPerPixel;
+	const double MaxDistance = SurfaceHit.Distance * (1.0 + PickDepthTolerance) + Settings->MeshEdgeSurfaceOffset;
+
+	float Alpha = 0.f;
+	const int32 EdgeIndex = WorldData->FindNearestEdgeToRay(RayOrigin, RayDirection, MaxDistance, WorldRadius, Alpha);
+	if (EdgeIndex != INDEX_NONE)
+	{
+		const FMeshEdgeOwner& Owner = WorldData->Owners[WorldData->FindOwnerOfEdge(EdgeIndex)];
+		const FMeshEdge& Edge = WorldData->Edges[EdgeIndex];
+		const FVector Position = FMath::Lerp(WorldData->GetWorldPosition(Owner, Edge.FirstIndex),
+		                                     WorldData->GetWorldPosition(Owner, Edge.SecondIndex), double(Alpha));
+		OutEdge.EdgeIndex = EdgeIndex;
+		OutEdge.Alpha = Alpha;
+		OutEdge.Distance = static_cast<float>(FMath::PointDistToLine(Position, RayDirection, RayOrigin) /
+			WorldUnitsPerPixel);
+		OutEdge.Depth = static_cast<float>(LastViewProjection->GetDepth(Position));
+	}
+
+	const int32 VertexIndex = WorldData->FindNearestVertexToRay(RayOrigin, RayDirection, MaxDistance, WorldRadius);
+	if (VertexIndex != INDEX_NONE)
+	{
+		const FVector Position = WorldData->GetWorldPosition(
+			WorldData->Owners[WorldData->FindOwnerOfVertex(VertexIndex)], VertexIndex);
+		OutVertex.VertexIndex = VertexIndex;
+		OutVertex.Distance = static_cast<float>(FMath::PointDistToLine(Position, RayDirection, RayOrigin) /
+			WorldUnitsPerPixel);
+		OutVertex.Depth = static_cast<float>(LastViewProjection->GetDepth(Position));
+	}
+}
+
 void FMeshEditorEditorMode::CollectCursorData(const FSceneView* InSceneView)
 {
-	bIsMouseMove = GetMouseVector2D() != MouseOnScreenPosition;
 	MouseOnScreenPosition = GetMouseVector2D();
 
-	FVector MouseWorldPosition;
-	FVector CameraDirection;
-	InSceneView->DeprojectFVector2D(MouseOnScreenPosition, MouseWorldPosition, CameraDirection);
+	// Picking casts rays against every owner, it only runs again once the cursor, the edges or the view changed
+	if (HoverPickView.IsSet() && LastViewProjection.IsSet() && HoverPickView->Equals(*LastViewProjection) &&
+		HoverPickSnapshotSerial == SnapshotSerial && HoverPickPosition == MouseOnScreenPosition)
+	{
+		return;
+	}
+	HoverPickPosition = MouseOnScreenPosition;
+	HoverPickSnapshotSerial = SnapshotSerial;
+	HoverPickView = LastViewProjection;
 
-	FCollisionQueryParams TraceQueryParams;
-	TraceQueryParams.bTraceComplex = true;
+	PickAt(InSceneView, MouseOnScreenPosition, HoveredEdge, HoveredVertex);
+	PrewarmHoveredTopology();
+}
 
-	FHitResult HitResult;
-	GetWorld()->LineTraceSingleByChannel(HitResult, MouseWorldPosition,
-	                                     MouseWorldPosition + (CameraDirection * 10000000), ECC_Visibility,
-	                                     TraceQueryParams);
+void FMeshEditorEditorMode::PrewarmHoveredTopology()
+{
+	const FMeshEdgeWorldData* WorldData = CapturedEdgeData.Read().WorldData.Get();
+	if (!HoveredEdge.IsValid() || !WorldData || !WorldData->Edges.IsValidIndex(HoveredEdge.EdgeIndex))
+	{
+		return;
+	}
 
-	// MouseInWorld = HitResult.ImpactPoint;
+	const FMeshEdgeOwner& Owner = WorldData->Owners[WorldData->FindOwnerOfEdge(HoveredEdge.EdgeIndex)];
+	const TPair<TObjectKey<UStaticMesh>, int32> TopologyKey{Owner.StaticMesh, Owner.LODIndex};
+	if (!Owner.StaticMesh || TopologyKey == PrewarmedTopologyKey)
+	{
+		return;
+	}
+	PrewarmedTopologyKey = TopologyKey;
+
+	// Builds the topology the next double click walks, away from the game thread and without holding up collections
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [StaticMesh = Owner.StaticMesh, LODIndex = Owner.LODIndex]()
+	{
+		FMeshTopology::FindOrBuild(StaticMesh, LODIndex);
+	});
+}
+
+void FMeshEditorEditorMode::DrawHoveredElements(FPrimitiveDrawInterface* PDI)
+{
+	const FMeshEdgeWorldData* WorldData = CapturedEdgeData.Read().WorldData.Get();
+	if (!WorldData)
+	{
+		return;
+	}
+
+	const UMeshEditorSettings* Settings{UMeshEditorSettings::Get()};
+	if (HoveredEdge.IsValid() && WorldData->Edges.IsValidIndex(HoveredEdge.EdgeIndex))
+	{
+		const FMeshEdgeOwner& Owner = WorldData->Owners[WorldData->FindOwnerOfEdge(HoveredEdge.EdgeIndex)];
+		const FMeshEdge& Edge = WorldData->Edges[HoveredEdge.EdgeIndex];
+		PDI->DrawLine(WorldData->GetWorldPosition(Owner, Edge.FirstIndex),
+		              WorldData->GetWorldPosition(Owner, Edge.SecondIndex), Settings->MeshEdgeHoverColor,
+		              SDPG_Foreground, Settings->MeshEdgeThickness + 1.f);
+	}
+	if (HoveredVertex.IsValid() && WorldData->Positions.IsValidIndex(HoveredVertex.VertexIndex))
+	{
+		const FMeshEdgeOwner& Owner = WorldData->Owners[WorldData->FindOwnerOfVertex(HoveredVertex.VertexIndex)];
+		PDI->DrawPoint(WorldData->GetWorldPosition(Owner, HoveredVertex.VertexIndex), Settings->MeshEdgeHoverColor,
+		               8.f, SDPG_Foreground);
+	}
+}
+
+void FMeshEditorEditorMode::DrawSelectedEdgeLoop(FPrimitiveDrawInterface* PDI)
+{
+	const UMeshEditorSettings* Settings{UMeshEditorSettings::Get()};
+	for (int32 Index = 0; Index + 1 < SelectedLoopPositions.Num(); Index += 2)
+	{
+		PDI->DrawLine(SelectedLoopPositions[Index], SelectedLoopPositions[Index + 1], Settings->MeshEdgeSelectionColor,
+		              SDPG_Foreground, Settings->MeshEdgeThickness + 1.f);
+	}
 }
 
 void FMeshEditorEditorMode::CollectPressedKeysData(const FViewport* InViewport)
@@ -472,6 +1026,8 @@ void FMeshEditorEditorMode::CollectPressedKeysData(const FViewport* InViewport)
 
 void FMeshEditorEditorMode::Render(const FSceneView* View, FViewport* Viewport, FPrimitiveDrawInterface* PDI)
 {
+	SCOPE_CYCLE_COUNTER(STAT_MeshEditor_Render);
+
 	FEdMode::Render(View, Viewport, PDI);
 
 	if (bPreviousDroppingPreview)
@@ -483,41 +1039,25 @@ void FMeshEditorEditorMode::Render(const FSceneView* View, FViewport* Viewport,
 
 	EdModeView = View;
 
-	const auto EditorViewportClient = static_cast<FEditorViewportClient*>(Viewport->GetClient());
-	if (EditorViewportClient)
+	// Edges are projected for the viewport the user works in
+	if (Viewport == GEditor->GetActiveViewport())
 	{
-		const UMeshEditorSettings* Settings{UMeshEditorSettings::Get()};
-		const bool bIsPerspectiveView{EditorViewportClient->IsPerspective()};
-		const FVector EditorCameraLocation = EditorViewportClient->GetViewLocation();
-
-		// Draw edges
-		for (int i = 0; i < LastCapturedEdgeData.Num(); i ++)
+		const FMeshDataIterators::FViewProjection ViewProjection(*View, DPIScale);
+		if (!LastViewProjection.IsSet() || !LastViewProjection->Equals(ViewProjection) ||
+			LastViewProjection->ViewKey != ViewProjection.ViewKey)
 		{
-			{
-				const FMeshEdgeData& EdgeData{LastCapturedEdgeData[i]};
-
-				FVector FirstEndpointLocation{EdgeData.FirstEndpointInWorldPosition};
-				FVector SecondEndpointLocation{EdgeData.SecondEndpointInWorldPosition};
-
-				if (bIsPerspectiveView)
-				{
-					//	Draw the sprite with a slight offset towards the camera to avoid gaps in the geometry
-					FirstEndpointLocation += (EditorCameraLocation - EdgeData.FirstEndpointInWorldPosition).
-						GetSafeNormal() * 3;
-					SecondEndpointLocation += (EditorCameraLocation - EdgeData.SecondEndpointInWorldPosition).
-						GetSafeNormal() * 3;
-				}
-
-				HMeshEdgeProxy* HitResult = new HMeshEdgeProxy(
-					EdgeData.FirstEndpointInWorldPosition, EdgeData.SecondEndpointInWorldPosition,
-					EdgeData.EdgeOwnerActor);
-
-				PDI->SetHitProxy(HitResult);
-				PDI->DrawLine(FirstEndpointLocation, SecondEndpointLocation, Settings->MeshEdgeColor,
-				              SDPG_World, Settings->MeshEdgeThickness);
-			}
+			LastViewProjection = ViewProjection;
+			bViewDirty = true;
 		}
 
+		CollectCursorData(View);
+		DrawSelectedEdgeLoop(PDI);
+		DrawHoveredElements(PDI);
+	}
+
+	const auto EditorViewportClient = static_cast<FEditorViewportClient*>(Viewport->GetClient());
+	if (EditorViewportClient)
+	{
 		// Draw bracket box for selected actors
 		for (int k = CurrentMeshData->SelectedActors.Num() - 1; k >= 0; k --)
 		{
@@ -600,6 +1140,8 @@ void FMeshEditorEditorMode::DrawBoxDraggerForStaticMeshActor(FPrimitiveDrawInter
 void FMeshEditorEditorMode::DrawBracketForMeshComp(FPrimitiveDrawInterface* PDI, const UStaticMeshComponent* InMeshComp,
                                                    TArray<FVector>& OutVerts)
 {
+	SCOPE_CYCLE_COUNTER(STAT_MeshEditor_DrawBrackets);
+
 	if (InMeshComp == nullptr)
 	{
 		return;
@@ -736,163 +1278,110 @@ void FMeshEditorEditorMode::DrawDraggerForMeshComp(FPrimitiveDrawInterface* PDI,
 
 void FMeshEditorEditorMode::CollectingMeshDataFinished()
 {
-	LastCapturedEdgeData = CapturedEdgeData;
 	bDataCollectionInProgress = false;
-
-	if (bIsModeOn)
+	if (!bIsModeOn)
 	{
-		AsyncCollectMeshData();
+		ReleaseCollectedData();
 	}
 }
 
-struct DistanceCMP
+void FMeshEditorEditorMode::AsyncCollectMeshData()
 {
-	DistanceCMP(FVector InTarget): Target(InTarget)
+	// Only one collection may write to the triple buffer at a time
+	if (bDataCollectionInProgress.exchange(true))
 	{
+		return;
 	}
 
-	FORCEINLINE bool operator()(const FVector& A, const FVector& B) const
+	SCOPE_CYCLE_COUNTER(STAT_MeshEditor_GatherRequest);
+
+	// Snapshot everything the collector needs while on the game thread. A camera move alone only reprojects, unless
+	// it changes the LOD of a component
+	UpdateEdgeLODs();
+	FMeshEdgeCollectRequest Request;
+	Request.bCollectWorld = bCollectionRequested || DirtyComponents.Num() > 0;
+	Request.EdgeFilter.Classes = static_cast<EMeshEdgeClass>(UMeshEditorSettings::Get()->MeshEdgeClasses);
+	Request.EdgeFilter.CreaseAngle = UMeshEditorSettings::Get()->MeshEdgeCreaseAngle;
+	Request.bProjectScreen = bScreenEdgesRequired && LastViewProjection.IsSet();
+	if (Request.bProjectScreen)
 	{
-		return FVector::Distance(Target, A) > FVector::Distance(Target, B);
+		Request.ViewProjection = LastViewProjection.GetValue();
+		Request.bCullBackFaces = UMeshEditorSettings::Get()->bCullBackFacingEdges;
+		Request.bSilhouettesOnly = UMeshEditorSettings::Get()->bShowSilhouetteEdgesOnly;
 	}
 
-	FVector Target;
-};
-
-// TODO remove ComputeMostKAdjacentVertics
-void ComputeMostKAdjacentVertics(uint32 K, uint32 ComparedIndex, FVector Target,
-                                 UPrimitiveComponent* PrimitiveComponent,
-                                 TArray<FVector>& OutAdjacentVertices)
-{
-	TArray<FVector> Heap;
-	TSharedPtr<FMeshDataIterators::FVertexIterator> VertexGetter =
-		FMeshDataIterators::MakeVertexIterator(PrimitiveComponent);
-	if (VertexGetter.IsValid())
+	for (const TWeakObjectPtr<UPrimitiveComponent>& TrackedComponent : TrackedComponents)
 	{
-		FMeshDataIterators::FVertexIterator& VertexGetterRef = *VertexGetter;
-		uint32 i = 0;
-		for (; VertexGetterRef; ++VertexGetterRef, i ++)
+		UPrimitiveComponent* MeshComponent = TrackedComponent.Get();
+		if (!IsValid(MeshComponent))
 		{
-			if (i == ComparedIndex)
+			continue;
+		}
+
+		// Dynamic meshes are extracted here, skinned meshes only hand over their bone matrices and are skinned by the
+		// collection task
+		const UStaticMeshComponent* StaticMeshComponent = Cast<UStaticMeshComponent>(MeshComponent);
+		const UStaticMesh* StaticMesh = StaticMeshComponent ? StaticMeshComponent->GetStaticMesh() : nullptr;
+		const int32 LODIndex = EdgeLODs.FindRef(MeshComponent);
+		FMeshSourceDataPtr MeshSource;
+		TOptional<FMeshSkinnedPose> SkinnedPose;
+		if (USkinnedMeshComponent* SkinnedComponent = Cast<USkinnedMeshComponent>(MeshComponent))
+		{
+			FMeshSkinnedPose& Pose = SkinnedPose.Emplace();
+			if (!FMeshSources::CapturePose(SkinnedComponent, LODIndex, Pose))
 			{
 				continue;
 			}
-			Heap.Emplace(VertexGetterRef.Position());
 		}
-
-		uint32 TotalVertex = Heap.Num();
-		Heap.Heapify(DistanceCMP(Target));
-		for (uint32 j = 0; j < K && j < TotalVertex; j ++)
+		else if (!StaticMeshComponent)
+		{
+			MeshSource = FMeshSources::FindOrExtract(MeshComponent, LODIndex);
+		}
+		if (!StaticMesh && !MeshSource.IsValid() && !SkinnedPose.IsSet())
 		{
-			FVector V;
-			Heap.HeapPop(V, DistanceCMP(Target));
-			OutAdjacentVertices.Add(V);
+			continue;
 		}
+
+		FMeshEdgeCollectRequest::FComponentInput& Input = Request.Components.AddDefaulted_GetRef();
+		Input.ComponentKey = MeshComponent;
+		Input.Owner = MeshComponent->GetOwner();
+		Input.StaticMesh = StaticMesh;
+		Input.MeshSource = MoveTemp(MeshSource);
+		Input.SkinnedPose = MoveTemp(SkinnedPose);
+		Input.LODIndex = LODIndex;
+		Input.ComponentTransform = MeshComponent->GetComponentTransform();
+		Input.bDirty = DirtyComponents.Contains(MeshComponent);
 	}
-}
 
-void FMeshEditorEditorMode::AsyncCollectMeshData()
-{
-	if (bDataCollectionInProgress)
+	if (!Request.bCollectWorld)
 	{
-		return;
+		Request.Components.Reset();
 	}
 
-	if (!EdModeView)
+	// The selected loop is kept in world space, it no longer lines up once its component moved or changed
+	if (DirtyComponents.Contains(SelectedLoopComponent))
 	{
-		return;
+		ClearEdgeLoop();
 	}
 
+	bCollectionRequested = false;
+	bViewDirty = false;
+	DirtyComponents.Reset();
+
 	TWeakPtr<FMeshEditorEditorMode> WeakThisPtr{SharedThis(this)};
-	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [WeakThisPtr]()
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [WeakThisPtr, Request = MoveTemp(Request)]()
 	{
-		FMeshEditorEditorMode* ThisBackgroundThread{WeakThisPtr.Pin().Get()};
+		// Keep the mode alive until the collection is published
+		const TSharedPtr<FMeshEditorEditorMode> ThisBackgroundThread{WeakThisPtr.Pin()};
 		if (!ThisBackgroundThread)
 		{
 			return;
 		}
 
-		ThisBackgroundThread->bDataCollectionInProgress = true;
-		ThisBackgroundThread->CapturedEdgeData.Empty();
-
-		//	Filter visible actors // TODO remove
-		auto ActorWasRendered = [](const AActor* InActor)
-		{
-			return InActor && InActor->WasRecentlyRendered();
-		};
-
-		TArray<AStaticMeshActor*> ActorsOnScreen{};
-		USelection* CurrentEditorSelection = GEditor->GetSelectedActors();
-		CurrentEditorSelection->GetSelectedObjects<AStaticMeshActor>(ActorsOnScreen);
-
-		for (int i = 0; i < ActorsOnScreen.Num(); ++i)
-		{
-			//	Take one hundred closest actors and collect data on their vertices
-			const AActor* CurrentActor = ActorsOnScreen[i];
-
-			// TODO remove
-			if (!CurrentActor->IsA(AStaticMeshActor::StaticClass()))
-			{
-				continue;
-			}
-
-			TInlineComponentArray<UStaticMeshComponent*> PrimitiveComponents;
-			CurrentActor->GetComponents<UStaticMeshComponent>(PrimitiveComponents);
-
-			for (UStaticMeshComponent* PrimitiveComponent : PrimitiveComponents)
-			{
-				// Skip sky sphere
-				if (IsValid(PrimitiveComponent))
-				{
-					TObjectPtr<UStaticMesh> StaticMesh = PrimitiveComponent->GetStaticMesh();
-					if (StaticMesh.Get())
-					{
-						FString StrStaticMeshName = StaticMesh->GetName();
-						if (StrStaticMeshName.Contains("SkySphere"))
-						{
-							continue;
-						}
-					}
-
-					// Check selection
-					// TODO remove selection check
-					AActor* Owner = PrimitiveComponent->GetOwner();
-					TSharedPtr<FMeshDataIterators::FEdgeIterator> EdgeGetter =
-						FMeshDataIterators::MakeEdgeIterator(PrimitiveComponent);
-					// Collect edges
-					if ((Owner != nullptr && Owner->IsSelected() || PrimitiveComponent->IsSelected()) &&
-						EdgeGetter.IsValid())
-					{
-						FMeshDataIterators::FEdgeIterator& EdgeGetterRef = *EdgeGetter;
-						for (; EdgeGetterRef; ++EdgeGetterRef)
-						{
-							FVector2D FirstVertexOnScreen{};
-							ThisBackgroundThread->EdModeView->WorldToPixel(
-								EdgeGetterRef.FirstEndpoint(), FirstVertexOnScreen);
-							FirstVertexOnScreen /= ThisBackgroundThread->DPIScale;
-
-							FVector2D SecondVertexOnScreen{};
-							ThisBackgroundThread->EdModeView->WorldToPixel(
-								EdgeGetterRef.SecondEndpoint(), SecondVertexOnScreen);
-							SecondVertexOnScreen /= ThisBackgroundThread->DPIScale;
-
-							FMeshEdgeData CapturedEdgeData;
-							CapturedEdgeData.EdgeOwnerActor = PrimitiveComponent->GetOwner();
-							CapturedEdgeData.FirstEndpointInWorldPosition = EdgeGetterRef.FirstEndpoint();
-							CapturedEdgeData.FirstEndpointOnScreenPosition = FirstVertexOnScreen;
-
-							CapturedEdgeData.SecondEndpointInWorldPosition = EdgeGetterRef.SecondEndpoint();
-							CapturedEdgeData.SecondEndpointOnScreenPosition = SecondVertexOnScreen;
-
-
-							ThisBackgroundThread->CapturedEdgeData.Add(CapturedEdgeData);
-						}
-					}
-				}
-			}
-		}
-
-		// Algo::Sort(ThisBackgroundThread->CapturedEdgeData);
+		// Reuse the allocations of the snapshot published two collections ago
+		FMeshEdgeSnapshot& Snapshot = ThisBackgroundThread->CapturedEdgeData.GetWriteBuffer();
+		ThisBackgroundThread->EdgeCollector.Collect(Request, Snapshot);
+		ThisBackgroundThread->CapturedEdgeData.SwapWriteBuffers();
 
 		AsyncTask(ENamedThreads::GameThread, [WeakThisPtr]()
 		{
@@ -905,12 +1394,4 @@ void FMeshEditorEditorMode::AsyncCollectMeshData()
 	});
 }
 
-void FMeshEditorEditorMode::InvalidateHitProxies()
-{
-	if (bIsMouseMove)
-	{
-		GEditor->GetActiveViewport()->InvalidateHitProxy();
-	}
-}
-
 #undef LOCTEXT_NAMESPACE
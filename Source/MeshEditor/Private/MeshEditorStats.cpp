@@ -0,0 +1,23 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshEditorStats.h"
+
+DEFINE_LOG_CATEGORY(LogMeshEditor);
+
+DEFINE_STAT(STAT_MeshEditor_Render);
+DEFINE_STAT(STAT_MeshEditor_DrawBrackets);
+DEFINE_STAT(STAT_MeshEditor_AxisWidgetDelta);
+DEFINE_STAT(STAT_MeshEditor_GatherRequest);
+DEFINE_STAT(STAT_MeshEditor_Pick);
+DEFINE_STAT(STAT_MeshEditor_SelectEdgeLoop);
+DEFINE_STAT(STAT_MeshEditor_CollectWorld);
+DEFINE_STAT(STAT_MeshEditor_ProjectEdges);
+DEFINE_STAT(STAT_MeshEditor_BuildScreenGrid);
+DEFINE_STAT(STAT_MeshEditor_OverlayDraw);
+DEFINE_STAT(STAT_MeshEditor_ComponentsCollected);
+DEFINE_STAT(STAT_MeshEditor_EdgesCollected);
+DEFINE_STAT(STAT_MeshEditor_VerticesCollected);
+DEFINE_STAT(STAT_MeshEditor_EdgesProjected);
+DEFINE_STAT(STAT_MeshEditor_EdgesDrawn);
+DEFINE_STAT(STAT_MeshEditor_HitProxies);
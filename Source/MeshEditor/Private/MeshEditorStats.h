@@ -0,0 +1,40 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogMeshEditor, Log, All);
+
+/** Shown by "stat MeshEditor" */
+DECLARE_STATS_GROUP(TEXT("MeshEditor"), STATGROUP_MeshEditor, STATCAT_Advanced);
+
+// Game thread
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mode Render"), STAT_MeshEditor_Render, STATGROUP_MeshEditor, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Draw Brackets"), STAT_MeshEditor_DrawBrackets, STATGROUP_MeshEditor, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Axis Widget Delta"), STAT_MeshEditor_AxisWidgetDelta, STATGROUP_MeshEditor, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gather Collect Request"), STAT_MeshEditor_GatherRequest, STATGROUP_MeshEditor, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pick"), STAT_MeshEditor_Pick, STATGROUP_MeshEditor, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Select Edge Loop"), STAT_MeshEditor_SelectEdgeLoop, STATGROUP_MeshEditor, );
+
+// Collection task
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Collect World Edges"), STAT_MeshEditor_CollectWorld, STATGROUP_MeshEditor, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Project Edges"), STAT_MeshEditor_ProjectEdges, STATGROUP_MeshEditor, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Screen Grid"), STAT_MeshEditor_BuildScreenGrid, STATGROUP_MeshEditor, );
+
+// Render thread
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Overlay Dynamic Elements"), STAT_MeshEditor_OverlayDraw, STATGROUP_MeshEditor, );
+
+/** Results of the last collection, kept until the next one */
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Components Collected"), STAT_MeshEditor_ComponentsCollected,
+                                      STATGROUP_MeshEditor, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Edges Collected"), STAT_MeshEditor_EdgesCollected, STATGROUP_MeshEditor, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Vertices Collected"), STAT_MeshEditor_VerticesCollected,
+                                      STATGROUP_MeshEditor, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Edges Projected"), STAT_MeshEditor_EdgesProjected, STATGROUP_MeshEditor, );
+
+/** Counted again every frame */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Edges Drawn"), STAT_MeshEditor_EdgesDrawn, STATGROUP_MeshEditor, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hit Proxies"), STAT_MeshEditor_HitProxies, STATGROUP_MeshEditor, );
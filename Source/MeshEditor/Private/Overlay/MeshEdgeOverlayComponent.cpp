@@ -0,0 +1,472 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MeshEdgeOverlayComponent.h"
+#include "DynamicMeshBuilder.h"
+#include "LocalVertexFactory.h"
+#include "MaterialShared.h"
+#include "MeshEditorSettings.h"
+#include "MeshEditorStats.h"
+#include "PrimitiveSceneProxy.h"
+#include "SceneManagement.h"
+#include "StaticMeshResources.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/Engine.h"
+#include "Materials/Material.h"
+
+namespace
+{
+	/** Past this many visible runs of clusters in one view, a single batch spanning all of them is drawn instead */
+	constexpr int32 MaxBatchesPerView = 32;
+
+	/** Screen space line material of the modeling tools, it widens quads built by SetThickLines on the GPU */
+	const TCHAR* ThickLineMaterialPath = TEXT("/MeshModelingToolset/Materials/LineMaterial.LineMaterial");
+
+	/** Render resources of one set of edges */
+	struct FMeshEdgeBuffers
+	{
+		explicit FMeshEdgeBuffers(ERHIFeatureLevel::Type FeatureLevel)
+			: VertexFactory(FeatureLevel, "FMeshEdgeOverlaySceneProxy")
+		{
+		}
+
+		void Release()
+		{
+			VertexBuffers.PositionVertexBuffer.ReleaseResource();
+			VertexBuffers.StaticMeshVertexBuffer.ReleaseResource();
+			VertexBuffers.ColorVertexBuffer.ReleaseResource();
+			IndexBuffer.ReleaseResource();
+			VertexFactory.ReleaseResource();
+		}
+
+		FStaticMeshVertexBuffers VertexBuffers;
+		FDynamicMeshIndexBuffer32 IndexBuffer;
+		FLocalVertexFactory VertexFactory;
+		int32 NumVertices{0};
+		int32 NumEdges{0};
+	};
+
+	/**
+	 * Proxy of the edge overlay, drawn as a line list. Lines wider than a pixel cannot be drawn from a line list, in
+	 * that case every edge becomes a quad of a triangle list instead, which the line material turns to face the
+	 * camera. Either way the buffers are only rebuilt when the drawn edges change.
+	 * View edges of the collector, e.g. the silhouette, only hold for the view they were found from. Every other view
+	 * draws all edges, culled by cluster.
+	 */
+	class FMeshEdgeOverlaySceneProxy final : public FPrimitiveSceneProxy
+	{
+	public:
+		/**
+		* @param ViewEdges Edges drawn instead of those of the world data in the view they were found from, null to
+		* draw all edges in every view
+		* @param InViewKey FSceneView::GetViewKey of the view the view edges were found from
+		* @param ThickLineMaterial Material of lines wider than a pixel, null to draw them a pixel wide
+		*/
+		FMeshEdgeOverlaySceneProxy(const UMeshEdgeOverlayComponent* Component, const FMeshEdgeWorldData& WorldData,
+		                           const TArray<FMeshEdge>* ViewEdges, uint32 InViewKey,
+		                           UMaterialInterface* ThickLineMaterial)
+			: FPrimitiveSceneProxy(Component)
+			  , AllEdgeBuffers(GetScene().GetFeatureLevel())
+			  , ViewEdgeBuffers(GetScene().GetFeatureLevel())
+			  , Clusters(WorldData.Clusters)
+			  , ViewKey(InViewKey)
+		{
+			const UMeshEditorSettings* Settings{UMeshEditorSettings::Get()};
+			Color = FLinearColor(Settings->MeshEdgeColor);
+			Thickness = Settings->MeshEdgeThickness;
+			bCullBackFaces = Settings->bCullBackFacingEdges;
+			bThickLines = Thickness > 1.f && ThickLineMaterial != nullptr;
+			Material = bThickLines ? ThickLineMaterial : GEngine->WireframeMaterial;
+			MaterialRelevance = Material->GetRelevance_Concurrent(GetScene().GetFeatureLevel());
+			bHasViewEdges = ViewEdges != nullptr;
+
+			// Vertices are relative to the component location and pushed out of the surface along their normal
+			const FVector Origin = Component->GetComponentLocation();
+			Positions.Reserve(WorldData.Positions.Num());
+			for (const FMeshEdgeOwner& Owner : WorldData.Owners)
+			{
+				const FVector3f OwnerOffset{Owner.Origin - Origin};
+				for (int32 VertexIndex = Owner.FirstVertex; VertexIndex < Owner.FirstVertex + Owner.NumVertices;
+				     ++VertexIndex)
+				{
+					Positions.Add(OwnerOffset + WorldData.Positions[VertexIndex] +
+						WorldData.Normals[VertexIndex] * Settings->MeshEdgeSurfaceOffset);
+				}
+			}
+
+			SetEdges(AllEdgeBuffers, WorldData.Edges);
+			if (bHasViewEdges)
+			{
+				SetEdges(ViewEdgeBuffers, *ViewEdges);
+			}
+			else
+			{
+				// View edges may be replaced by other edges later on, which needs the positions again
+				Positions.Empty();
+			}
+		}
+
+		virtual ~FMeshEdgeOverlaySceneProxy() override
+		{
+			AllEdgeBuffers.Release();
+			ViewEdgeBuffers.Release();
+		}
+
+		/** Replaces the view edges. Only the index buffer is rebuilt for lines a pixel wide. */
+		void SetViewEdges_RenderThread(const TArray<FMeshEdge>& ViewEdges, uint32 InViewKey)
+		{
+			check(IsInRenderingThread() && bHasViewEdges);
+
+			ViewKey = InViewKey;
+			ViewEdgeBuffers.IndexBuffer.ReleaseResource();
+			SetEdges(ViewEdgeBuffers, ViewEdges);
+		}
+
+		virtual SIZE_T GetTypeHash() const override
+		{
+			static size_t UniquePointer;
+			return reinterpret_cast<size_t>(&UniquePointer);
+		}
+
+		virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily,
+		                                    uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+		{
+			SCOPE_CYCLE_COUNTER(STAT_MeshEditor_OverlayDraw);
+
+			// Thick lines carry their color in the vertices
+			const FMaterialRenderProxy* MaterialProxy = Material->GetRenderProxy();
+			if (!bThickLines)
+			{
+				FColoredMaterialRenderProxy* ColoredProxy = new FColoredMaterialRenderProxy(MaterialProxy, Color);
+				Collector.RegisterOneFrameMaterialProxy(ColoredProxy);
+				MaterialProxy = ColoredProxy;
+			}
+
+			// Each edge is two indices of a line list, or a quad of two triangles
+			const int32 IndicesPerEdge = bThickLines ? 6 : 2;
+			const int32 PrimitivesPerEdge = bThickLines ? 2 : 1;
+
+			TArray<FMeshIndexRun> VisibleRuns;
+			for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ++ViewIndex)
+			{
+				if (!(VisibilityMap & (1 << ViewIndex)))
+				{
+					continue;
+				}
+
+				const FSceneView& View = *Views[ViewIndex];
+				const bool bDrawsViewEdges = bHasViewEdges && View.GetViewKey() == ViewKey;
+				const FMeshEdgeBuffers& Buffers = bDrawsViewEdges ? ViewEdgeBuffers : AllEdgeBuffers;
+				if (Buffers.NumEdges == 0)
+				{
+					continue;
+				}
+
+				// View edges were already culled by the collector and are drawn in a single run
+				if (bDrawsViewEdges)
+				{
+					VisibleRuns.Reset();
+					VisibleRuns.Add(FMeshIndexRun{0, Buffers.NumEdges});
+				}
+				else
+				{
+					GetVisibleEdgeRuns(View, VisibleRuns);
+				}
+				if (VisibleRuns.Num() > MaxBatchesPerView)
+				{
+					const int32 EndEdge = VisibleRuns.Last().First + VisibleRuns.Last().Num;
+					VisibleRuns.SetNum(1, false);
+					VisibleRuns[0].Num = EndEdge - VisibleRuns[0].First;
+				}
+
+				// Lines a pixel wide share the vertices of all edges, quads have vertices of their own
+				const FMeshEdgeBuffers& VertexSource = bThickLines ? Buffers : AllEdgeBuffers;
+				for (const FMeshIndexRun& Run : VisibleRuns)
+				{
+					INC_DWORD_STAT_BY(STAT_MeshEditor_EdgesDrawn, Run.Num);
+
+					FMeshBatch& Mesh = Collector.AllocateMesh();
+					Mesh.VertexFactory = &VertexSource.VertexFactory;
+					Mesh.MaterialRenderProxy = MaterialProxy;
+					Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
+					Mesh.Type = bThickLines ? PT_TriangleList : PT_LineList;
+					Mesh.DepthPriorityGroup = SDPG_World;
+					Mesh.bCanApplyViewModeOverrides = false;
+					Mesh.CastShadow = false;
+
+					FMeshBatchElement& BatchElement = Mesh.Elements[0];
+					BatchElement.IndexBuffer = &Buffers.IndexBuffer;
+					BatchElement.PrimitiveUniformBuffer = GetUniformBuffer();
+					BatchElement.FirstIndex = Run.First * IndicesPerEdge;
+					BatchElement.NumPrimitives = Run.Num * PrimitivesPerEdge;
+					BatchElement.MinVertexIndex = 0;
+					BatchElement.MaxVertexIndex = VertexSource.NumVertices - 1;
+
+					Collector.AddMesh(ViewIndex, Mesh);
+				}
+			}
+		}
+
+		virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+		{
+			FPrimitiveViewRelevance Result;
+			Result.bDrawRelevance = IsShown(View);
+			Result.bDynamicRelevance = true;
+			Result.bShadowRelevance = false;
+			Result.bRenderInMainPass = ShouldRenderInMainPass();
+			Result.bEditorPrimitiveRelevance = UseEditorCompositing(View);
+			MaterialRelevance.SetPrimitiveViewRelevance(Result);
+			return Result;
+		}
+
+		virtual uint32 GetMemoryFootprint() const override
+		{
+			return sizeof(*this) + GetAllocatedSize();
+		}
+
+		uint32 GetAllocatedSize() const
+		{
+			return FPrimitiveSceneProxy::GetAllocatedSize() + AllEdgeBuffers.IndexBuffer.Indices.GetAllocatedSize() +
+				ViewEdgeBuffers.IndexBuffer.Indices.GetAllocatedSize() + Positions.GetAllocatedSize() +
+				Clusters.GetAllocatedSize();
+		}
+
+	private:
+		void SetEdges(FMeshEdgeBuffers& Buffers, const TArray<FMeshEdge>& Edges)
+		{
+			if (bThickLines)
+			{
+				SetThickLines(Buffers, Edges);
+			}
+			else
+			{
+				SetLines(Buffers, Edges);
+			}
+		}
+
+		/** Builds a line list. Only the buffers of all edges hold vertices, the view edges share them. */
+		void SetLines(FMeshEdgeBuffers& Buffers, const TArray<FMeshEdge>& Edges)
+		{
+			Buffers.IndexBuffer.Indices.SetNumUninitialized(Edges.Num() * 2);
+			FMemory::Memcpy(Buffers.IndexBuffer.Indices.GetData(), Edges.GetData(), Edges.Num() * sizeof(FMeshEdge));
+			Buffers.NumEdges = Edges.Num();
+			Buffers.NumVertices = Positions.Num();
+
+			if (&Buffers == &AllEdgeBuffers && Buffers.NumVertices > 0)
+			{
+				TArray<FDynamicMeshVertex> Vertices;
+				Vertices.Reserve(Buffers.NumVertices);
+				for (const FVector3f& Position : Positions)
+				{
+					Vertices.Emplace(Position);
+				}
+				Buffers.VertexBuffers.InitFromDynamicVertex(&Buffers.VertexFactory, Vertices);
+			}
+			if (Buffers.NumEdges > 0)
+			{
+				BeginInitResource(&Buffers.IndexBuffer);
+			}
+		}
+
+		/**
+		* Builds a quad of four vertices per edge. Both ends of the quad start out on the edge, the tangent Z of each
+		* vertex points along the edge away from the end it widens and the first texture coordinate holds the width
+		* in pixels and the depth bias, which the line material reads.
+		*/
+		void SetThickLines(FMeshEdgeBuffers& Buffers, const TArray<FMeshEdge>& Edges)
+		{
+			Buffers.NumEdges = Edges.Num();
+			Buffers.NumVertices = Buffers.NumEdges * 4;
+			if (Buffers.NumEdges == 0)
+			{
+				Buffers.IndexBuffer.Indices.Empty();
+				return;
+			}
+
+			TArray<FDynamicMeshVertex> Vertices;
+			Vertices.Reserve(Buffers.NumVertices);
+			Buffers.IndexBuffer.Indices.SetNumUninitialized(Buffers.NumEdges * 6);
+			const FVector2f WidthAndDepthBias{Thickness, 0.f};
+			const FColor VertexColor = Color.ToFColor(true);
+			for (int32 EdgeIndex = 0; EdgeIndex < Buffers.NumEdges; ++EdgeIndex)
+			{
+				const FVector3f& Start = Positions[Edges[EdgeIndex].FirstIndex];
+				const FVector3f& End = Positions[Edges[EdgeIndex].SecondIndex];
+				const FVector3f Direction = (End - Start).GetSafeNormal();
+
+				const uint32 FirstVertex = Vertices.Num();
+				Vertices.Emplace(Start, FVector3f::ZeroVector, -Direction, WidthAndDepthBias, VertexColor);
+				Vertices.Emplace(End, FVector3f::ZeroVector, -Direction, WidthAndDepthBias, VertexColor);
+				Vertices.Emplace(End, FVector3f::ZeroVector, Direction, WidthAndDepthBias, VertexColor);
+				Vertices.Emplace(Start, FVector3f::ZeroVector, Direction, WidthAndDepthBias, VertexColor);
+
+				uint32* Indices = Buffers.IndexBuffer.Indices.GetData() + EdgeIndex * 6;
+				Indices[0] = FirstVertex;
+				Indices[1] = FirstVertex + 1;
+				Indices[2] = FirstVertex + 2;
+				Indices[3] = FirstVertex + 2;
+				Indices[4] = FirstVertex + 3;
+				Indices[5] = FirstVertex;
+			}
+
+			// Safe on the render thread, the buffers are then initialized right away
+			Buffers.VertexBuffers.InitFromDynamicVertex(&Buffers.VertexFactory, Vertices);
+			BeginInitResource(&Buffers.IndexBuffer);
+		}
+
+		/** Edge ranges of the clusters the view can see, consecutive visible clusters share one run */
+		void GetVisibleEdgeRuns(const FSceneView& View, TArray<FMeshIndexRun>& OutRuns) const
+		{
+			OutRuns.Reset();
+			const FVector ViewOrigin = View.ViewMatrices.GetViewOrigin();
+			const FVector ViewDirection = View.GetViewDirection();
+			const bool bIsPerspective = View.IsPerspectiveProjection();
+			for (const FMeshEdgeWorldCluster& Cluster : Clusters)
+			{
+				if (Cluster.NumEdges == 0 || !Cluster.IsInFrustum(View.ViewFrustum) ||
+					(bCullBackFaces && Cluster.IsBackFacing(ViewOrigin, ViewDirection, bIsPerspective)))
+				{
+					continue;
+				}
+
+				if (OutRuns.Num() > 0 && OutRuns.Last().First + OutRuns.Last().Num == Cluster.FirstEdge)
+				{
+					OutRuns.Last().Num += Cluster.NumEdges;
+				}
+				else
+				{
+					OutRuns.Add(FMeshIndexRun{Cluster.FirstEdge, Cluster.NumEdges});
+				}
+			}
+		}
+
+		/** Every edge of the world data, in the order of Clusters */
+		FMeshEdgeBuffers AllEdgeBuffers;
+		/** Edges drawn in the view with ViewKey instead, empty unless bHasViewEdges */
+		FMeshEdgeBuffers ViewEdgeBuffers;
+		/** Edge vertices relative to the component, only kept while view edges may be replaced */
+		TArray<FVector3f> Positions;
+		/** World space clusters covering the edges of AllEdgeBuffers in order, culled per view */
+		TArray<FMeshEdgeWorldCluster> Clusters;
+		uint32 ViewKey;
+		bool bCullBackFaces;
+		bool bHasViewEdges;
+		/** The buffers hold a quad per edge rather than a line list */
+		bool bThickLines;
+
+		UMaterialInterface* Material;
+		FMaterialRelevance MaterialRelevance;
+		FLinearColor Color;
+		float Thickness;
+	};
+}
+
+UMeshEdgeOverlayComponent::UMeshEdgeOverlayComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	Mobility = EComponentMobility::Movable;
+	bIsEditorOnly = true;
+	bHiddenInGame = true;
+	bSelectable = false;
+	bUseEditorCompositing = true;
+	CastShadow = false;
+	SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+	SetGenerateOverlapEvents(false);
+}
+
+void UMeshEdgeOverlayComponent::SetWorldData(const FMeshEdgeWorldDataPtr& InWorldData,
+                                             const FMeshEdgeListPtr& InViewEdges, uint32 InViewKey)
+{
+	if (WorldData == InWorldData)
+	{
+		if (ViewEdges == InViewEdges && (!ViewEdges.IsValid() || ViewKey == InViewKey))
+		{
+			return;
+		}
+
+		// Only proxies made with view edges keep the positions to build others, it has to be recreated
+		const bool bHadViewEdges = ViewEdges.IsValid();
+		ViewEdges = InViewEdges;
+		ViewKey = InViewKey;
+		if (bHadViewEdges != ViewEdges.IsValid())
+		{
+			MarkRenderStateDirty();
+		}
+		else if (SceneProxy)
+		{
+			FMeshEdgeOverlaySceneProxy* Proxy = static_cast<FMeshEdgeOverlaySceneProxy*>(SceneProxy);
+			ENQUEUE_RENDER_COMMAND(SetMeshEdgeOverlayViewEdges)(
+				[Proxy, Edges = ViewEdges, InViewKey](FRHICommandListImmediate&)
+				{
+					Proxy->SetViewEdges_RenderThread(*Edges, InViewKey);
+				});
+		}
+		return;
+	}
+	WorldData = InWorldData;
+	ViewEdges = InViewEdges;
+	ViewKey = InViewKey;
+
+	FBox WorldBounds(ForceInit);
+	if (WorldData.IsValid())
+	{
+		for (const FMeshEdgeOwner& Owner : WorldData->Owners)
+		{
+			for (int32 VertexIndex = Owner.FirstVertex; VertexIndex < Owner.FirstVertex + Owner.NumVertices;
+			     ++VertexIndex)
+			{
+				WorldBounds += WorldData->GetWorldPosition(Owner, VertexIndex);
+			}
+		}
+	}
+
+	// Center the component on the edges so that the single precision vertices stay close to their origin
+	const FVector Origin = WorldBounds.IsValid ? WorldBounds.GetCenter() : FVector::ZeroVector;
+	LocalBounds = WorldBounds.IsValid
+		              ? WorldBounds.ShiftBy(-Origin).ExpandBy(UMeshEditorSettings::Get()->MeshEdgeSurfaceOffset)
+		              : FBox(ForceInit);
+
+	SetWorldLocation(Origin);
+	UpdateBounds();
+	MarkRenderStateDirty();
+}
+
+void UMeshEdgeOverlayComponent::RefreshAppearance()
+{
+	MarkRenderStateDirty();
+}
+
+FPrimitiveSceneProxy* UMeshEdgeOverlayComponent::CreateSceneProxy()
+{
+	if (!WorldData.IsValid() || WorldData->NumEdges() == 0)
+	{
+		return nullptr;
+	}
+	if (UMeshEditorSettings::Get()->MeshEdgeThickness > 1.f && !ThickLineMaterial)
+	{
+		ThickLineMaterial = LoadObject<UMaterialInterface>(nullptr, ThickLineMaterialPath);
+		UE_CLOG(!ThickLineMaterial, LogMeshEditor, Warning,
+		        TEXT("%s is missing, mesh edges are drawn a pixel wide"),
+		        ThickLineMaterialPath);
+	}
+	return new FMeshEdgeOverlaySceneProxy(this, *WorldData, ViewEdges.Get(), ViewKey, ThickLineMaterial);
+}
+
+FBoxSphereBounds UMeshEdgeOverlayComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	if (!LocalBounds.IsValid)
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.f);
+	}
+	return FBoxSphereBounds(LocalBounds).TransformBy(LocalToWorld);
+}
+
+void UMeshEdgeOverlayComponent::GetUsedMaterials(TArray<UMaterialInterface*>& OutMaterials,
+                                                 bool bGetDebugMaterials) const
+{
+	OutMaterials.Add(GEngine->WireframeMaterial);
+	if (ThickLineMaterial)
+	{
+		OutMaterials.Add(ThickLineMaterial);
+	}
+}
@@ -0,0 +1,51 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+#include "Collector/MeshEdgeCollector.h"
+#include "MeshEdgeOverlayComponent.generated.h"
+
+/**
+ * Draws the collected edges as one line list primitive, or as one quad list for lines wider than a pixel. The vertex
+ * and index buffers are only rebuilt when the world data changes, drawing them costs a single mesh batch per view
+ * regardless of the number of edges.
+ */
+UCLASS(Transient)
+class UMeshEdgeOverlayComponent : public UPrimitiveComponent
+{
+	GENERATED_BODY()
+
+public:
+	UMeshEdgeOverlayComponent(const FObjectInitializer& ObjectInitializer);
+
+	/**
+	* Replaces the drawn edges, nothing is rebuilt if the world data did not change
+	* @param InViewEdges Subset of the edges seen from one view to draw instead in that view, e.g. the silhouette
+	* edges. Other views draw all edges. Only the view edge buffers are rebuilt when these change alone.
+	* @param InViewKey FSceneView::GetViewKey of the view the view edges were found from
+	*/
+	void SetWorldData(const FMeshEdgeWorldDataPtr& InWorldData, const FMeshEdgeListPtr& InViewEdges = nullptr,
+	                  uint32 InViewKey = 0);
+
+	/** Rebuilds the render data, e.g. after the edge appearance settings changed */
+	void RefreshAppearance();
+
+	//~ Begin UPrimitiveComponent Interface
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	virtual void GetUsedMaterials(TArray<UMaterialInterface*>& OutMaterials,
+	                              bool bGetDebugMaterials = false) const override;
+	//~ End UPrimitiveComponent Interface
+
+private:
+	FMeshEdgeWorldDataPtr WorldData;
+	FMeshEdgeListPtr ViewEdges;
+	uint32 ViewKey{0};
+	/** Loaded on first use, only wide lines need it */
+	UPROPERTY(Transient)
+	TObjectPtr<UMaterialInterface> ThickLineMaterial;
+	/** Bounds of the edges relative to the component location */
+	FBox LocalBounds{ForceInit};
+};
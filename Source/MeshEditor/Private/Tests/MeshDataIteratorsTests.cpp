@@ -0,0 +1,206 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Helper/MeshDataIterators.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	/** Not a multiple of four, so the vectorized loops also run their scalar tail */
+	constexpr int32 NumTestElements = 1027;
+
+	/** Vector and scalar paths may fuse multiply adds differently, so results only match within a few ulps */
+	constexpr float RelativeTolerance = 1e-5f;
+
+	bool IsNear(float A, float B)
+	{
+		return FMath::Abs(A - B) <= RelativeTolerance * FMath::Max3(1.f, FMath::Abs(A), FMath::Abs(B));
+	}
+
+	/** Rotated, non uniformly scaled and far from the world origin */
+	FTransform MakeTestTransform()
+	{
+		return FTransform(FRotator(31.f, -127.f, 64.f), FVector(1.5e6, -2.25e6, 4.0e5), FVector(0.5, 3.0, 1.25));
+	}
+
+	TArray<FVector3f> MakeTestPositions(FRandomStream& Random)
+	{
+		TArray<FVector3f> Positions;
+		Positions.SetNumUninitialized(NumTestElements);
+		for (FVector3f& Position : Positions)
+		{
+			Position = FVector3f(Random.VRand()) * Random.FRandRange(0.f, 500.f);
+		}
+		return Positions;
+	}
+
+	/** Looks at the transform origin of MakeTestTransform from outside of the test positions */
+	FMeshDataIterators::FViewProjection MakeTestView()
+	{
+		const FVector Target = MakeTestTransform().GetTranslation();
+		const FVector Eye = Target + FVector(-4000.0, 1500.0, 800.0);
+
+		FMeshDataIterators::FViewProjection View;
+		View.ViewProjectionMatrix = FLookAtMatrix(Eye, Target, FVector::UpVector) *
+			FReversedZPerspectiveMatrix(UE_HALF_PI * 0.5, 1920.f, 1080.f, 10.f);
+		View.ViewRect = FIntRect(0, 0, 1920, 1080);
+		View.DPIScale = 1.25f;
+		View.ViewOrigin = Eye;
+		View.ViewDirection = (Target - Eye).GetSafeNormal();
+		return View;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMeshDataIteratorsTransformPositionsTest,
+                                 "MeshEditor.MeshDataIterators.TransformPositions",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FMeshDataIteratorsTransformPositionsTest::RunTest(const FString& Parameters)
+{
+	FRandomStream Random(0x5eed);
+	const TArray<FVector3f> LocalPositions = MakeTestPositions(Random);
+	const FTransform LocalToWorld = MakeTestTransform();
+
+	FMeshDataIterators::FWorldSpacePositions Positions;
+	FMeshDataIterators::FWorldSpacePositions ScalarPositions;
+	FMeshDataIterators::TransformPositions(LocalToWorld, LocalPositions, Positions);
+	FMeshDataIterators::TransformPositionsScalar(LocalToWorld, LocalPositions, ScalarPositions);
+
+	TestEqual(TEXT("Origin"), Positions.Origin, ScalarPositions.Origin);
+	if (!TestEqual(TEXT("Number of positions"), Positions.Num(), ScalarPositions.Num()))
+	{
+		return false;
+	}
+
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		const FVector3f Position = Positions.GetRelativePosition(Index);
+		const FVector3f ScalarPosition = ScalarPositions.GetRelativePosition(Index);
+		if (!IsNear(Position.X, ScalarPosition.X) || !IsNear(Position.Y, ScalarPosition.Y) ||
+			!IsNear(Position.Z, ScalarPosition.Z))
+		{
+			AddError(FString::Printf(TEXT("Position %d is %s, the scalar reference is %s"), Index,
+			                         *Position.ToString(), *ScalarPosition.ToString()));
+			return false;
+		}
+	}
+
+	// The world position has to match the transform too, not only the other implementation
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		const FVector Expected = LocalToWorld.TransformPosition(FVector(LocalPositions[Index]));
+		if (!Positions.GetPosition(Index).Equals(Expected, 0.01))
+		{
+			AddError(FString::Printf(TEXT("Position %d is %s, the transform gives %s"), Index,
+			                         *Positions.GetPosition(Index).ToString(), *Expected.ToString()));
+			return false;
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMeshDataIteratorsProjectPositionsTest,
+                                 "MeshEditor.MeshDataIterators.ProjectPositions",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FMeshDataIteratorsProjectPositionsTest::RunTest(const FString& Parameters)
+{
+	FRandomStream Random(0xbeef);
+	FMeshDataIterators::FWorldSpacePositions Positions;
+	FMeshDataIterators::TransformPositionsScalar(MakeTestTransform(), MakeTestPositions(Random), Positions);
+
+	for (const bool bFlipY : {false, true})
+	{
+		FMeshDataIterators::FViewProjection View = MakeTestView();
+		View.bFlipY = bFlipY;
+
+		FMeshDataIterators::FScreenSpacePositions ScreenPositions;
+		FMeshDataIterators::FScreenSpacePositions ScalarScreenPositions;
+		FMeshDataIterators::ProjectPositions(View, Positions, ScreenPositions);
+		FMeshDataIterators::ProjectPositionsScalar(View, Positions, ScalarScreenPositions);
+
+		if (!TestEqual(TEXT("Number of screen positions"), ScreenPositions.Num(), ScalarScreenPositions.Num()))
+		{
+			return false;
+		}
+
+		for (int32 Index = 0; Index < ScreenPositions.Num(); ++Index)
+		{
+			if (!IsNear(ScreenPositions.X[Index], ScalarScreenPositions.X[Index]) ||
+				!IsNear(ScreenPositions.Y[Index], ScalarScreenPositions.Y[Index]) ||
+				!IsNear(ScreenPositions.Depth[Index], ScalarScreenPositions.Depth[Index]))
+			{
+				AddError(FString::Printf(
+					TEXT("Screen position %d is (%f, %f, depth %f), the scalar reference is (%f, %f, depth %f)"),
+					Index, ScreenPositions.X[Index], ScreenPositions.Y[Index], ScreenPositions.Depth[Index],
+					ScalarScreenPositions.X[Index], ScalarScreenPositions.Y[Index],
+					ScalarScreenPositions.Depth[Index]));
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMeshDataIteratorsComputeFrontFacingTest,
+                                 "MeshEditor.MeshDataIterators.ComputeFrontFacing",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FMeshDataIteratorsComputeFrontFacingTest::RunTest(const FString& Parameters)
+{
+	FRandomStream Random(0xface);
+	FMeshDataIterators::FFacePlanes Planes;
+	Planes.SetNum(NumTestElements);
+	for (int32 Index = 0; Index < NumTestElements; ++Index)
+	{
+		// Every tenth face is degenerate like the edge table stores them, and never front facing
+		if (Index % 10 == 0)
+		{
+			Planes.Set(Index, FVector3f::ZeroVector, 0.f);
+		}
+		else
+		{
+			Planes.Set(Index, FVector3f(Random.VRand()), Random.FRandRange(-500.f, 500.f));
+		}
+	}
+
+	for (const bool bIsPerspective : {true, false})
+	{
+		const FVector3f LocalEye = bIsPerspective
+			                           ? FVector3f(-4000.f, 1500.f, 800.f)
+			                           : FVector3f(Random.VRand());
+
+		TArray<uint8> FrontFacing;
+		TArray<uint8> ScalarFrontFacing;
+		FMeshDataIterators::ComputeFrontFacing(Planes, LocalEye, bIsPerspective, FrontFacing);
+		FMeshDataIterators::ComputeFrontFacingScalar(Planes, LocalEye, bIsPerspective, ScalarFrontFacing);
+
+		if (!TestEqual(TEXT("Number of faces"), FrontFacing.Num(), ScalarFrontFacing.Num()))
+		{
+			return false;
+		}
+
+		for (int32 Index = 0; Index < FrontFacing.Num(); ++Index)
+		{
+			// Faces seen edge on may go either way depending on rounding
+			const float Side = FVector3f::DotProduct(Planes.GetNormal(Index), LocalEye) -
+				(bIsPerspective ? Planes.W[Index] : 0.f);
+			if (FMath::Abs(Side) <= RelativeTolerance * LocalEye.Size() * 4.f && Index % 10 != 0)
+			{
+				continue;
+			}
+			if (FrontFacing[Index] != ScalarFrontFacing[Index] || (Index % 10 == 0 && FrontFacing[Index] != 0))
+			{
+				AddError(FString::Printf(TEXT("Face %d is %s, the scalar reference says %s"), Index,
+				                         FrontFacing[Index] ? TEXT("front facing") : TEXT("back facing"),
+				                         ScalarFrontFacing[Index] ? TEXT("front facing") : TEXT("back facing")));
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+#endif
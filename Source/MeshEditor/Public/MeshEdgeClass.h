@@ -0,0 +1,25 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MeshEdgeClass.generated.h"
+
+/** Kinds of mesh edges, the overlay can be limited to some of them */
+UENUM(meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class EMeshEdgeClass : uint8
+{
+	None = 0 UMETA(Hidden),
+	/** Edges of a single triangle, along open borders and holes */
+	Boundary = 0x01,
+	/** Edges whose vertex normals on either side are more than MeshEdgeCreaseAngle apart */
+	Crease = 0x02,
+	/** Edges along which the first UV channel is split */
+	UVSeam = 0x04,
+	/** Edges between triangles of different materials */
+	Section = 0x08,
+	/** Edges that are none of the above */
+	Smooth = 0x10,
+	All = 0x1F UMETA(Hidden),
+};
+ENUM_CLASS_FLAGS(EMeshEdgeClass);
@@ -4,20 +4,19 @@
 
 #include "CoreMinimal.h"
 #include "EdMode.h"
+#include "Containers/TripleBuffer.h"
 #include "Dragger/AxisDragger.h"
 #include "Dragger/DragTransaction.h"
+#include "Collector/MeshEdgeCollector.h"
+#include "Helper/MeshDataIterators.h"
 #include "MeshEditorEditorMode.generated.h"
 
-DECLARE_DELEGATE(FOnCollectingMeshDataFinished);
+class FMeshTopology;
+class UMeshEdgeOverlayComponent;
+class UDynamicMesh;
+struct FDynamicMeshChangeInfo;
 
-struct FMeshEdgeData
-{
-	FVector FirstEndpointInWorldPosition{};
-	FVector SecondEndpointInWorldPosition{};
-	FVector2D FirstEndpointOnScreenPosition{};
-	FVector2D SecondEndpointOnScreenPosition{};
-	AActor* EdgeOwnerActor{nullptr};
-};
+DECLARE_DELEGATE(FOnCollectingMeshDataFinished);
 
 UCLASS()
 class UMeshGeoData : public UObject
@@ -62,8 +61,15 @@ public:
 
 	virtual void Tick(FEditorViewportClient* ViewportClient, float DeltaTime) override;
 
+	virtual bool MouseEnter(FEditorViewportClient* ViewportClient, FViewport* Viewport, int32 x, int32 y) override;
+	virtual bool MouseLeave(FEditorViewportClient* ViewportClient, FViewport* Viewport) override;
+
 	virtual FVector GetWidgetLocation() const override;
 
+	/** Aligns the transform widget with the selected edge loop or ring in local coordinates */
+	virtual bool GetCustomDrawingCoordinateSystem(FMatrix& InMatrix, void* InData) override;
+	virtual bool GetCustomInputCoordinateSystem(FMatrix& InMatrix, void* InData) override;
+
 	virtual void ActorSelectionChangeNotify() override;
 	
 	virtual bool StartTracking(FEditorViewportClient* InViewportClient, FViewport* InViewport) override;
@@ -74,12 +80,40 @@ public:
 
 	void CollectingMeshDataFinished();
 
-	void InvalidateHitProxies();
+	/** Clears the snapshots and the collector, then evicts cached mesh data no one else holds on to */
+	void ReleaseCollectedData();
 
 private:
 	void EraseDroppingPreview();
 
 	void CollectCursorData(const FSceneView* InSceneView);
+
+	/** Finds the visible edge and vertex around a DPI independent screen position in the published snapshot */
+	void PickAt(const FSceneView* View, const FVector2D& ScreenPosition, FMeshEdgePickResult& OutEdge,
+	            FMeshVertexPickResult& OutVertex);
+
+	/** Runs the screen space stage only while the cursor hovers a viewport or silhouette edges are shown */
+	void UpdateScreenEdgesRequired();
+
+	/** Builds the cached topology of the hovered static mesh in the background, ahead of a double click */
+	void PrewarmHoveredTopology();
+
+	/** Highlights the hovered edge and vertex */
+	void DrawHoveredElements(FPrimitiveDrawInterface* PDI);
+
+	/**
+	* Selects the edge loop or ring through an edge of the published snapshot, walking the cached topology of its
+	* mesh. The pivot of the selected actors moves to the center of the selected edges.
+	* @return False if the edge could not be found in the topology
+	*/
+	bool SelectEdgeLoop(int32 EdgeIndex, bool bRing);
+
+	void ClearEdgeLoop();
+
+	void DrawSelectedEdgeLoop(FPrimitiveDrawInterface* PDI);
+
+	/** Moves the pivot of the selected actors to a world position */
+	void SetPivotOfSelectedActors(const FVector& Pivot);
 	
 	void CollectPressedKeysData(const FViewport* InViewport);
 
@@ -96,29 +130,88 @@ private:
 
 	void UpdateInitialSelection();
 
+	/** Subscribes to the components whose edges are collected, based on the current selection */
+	void RefreshTrackedComponents();
+
+	void UntrackComponents();
+
+	void OnComponentTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags,
+	                                 ETeleportType Teleport);
+
+	void OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent);
+
+	/** Drops the extracted mesh of the tracked components showing the edited dynamic mesh */
+	void OnDynamicMeshChanged(UDynamicMesh* DynamicMesh, FDynamicMeshChangeInfo ChangeInfo);
+
+	/** Marks the skinned components whose pose changed since their mesh was last extracted as dirty */
+	void UpdateSkinnedComponents();
+
+	/** @return True if anything changed since the last collection was dispatched */
+	bool HasPendingCollection() const;
+
+	/** Picks the edge LOD of every tracked component for the last view, marks those that changed LOD as dirty */
+	void UpdateEdgeLODs();
+
 	FVector2D GetMouseVector2D();
 
 public:
-	TArray<FMeshEdgeData> LastCapturedEdgeData;
-	TArray<FMeshEdgeData> CapturedEdgeData;
+	/** Edges written by the collector thread and published to Render by swapping buffers */
+	TTripleBuffer<FMeshEdgeSnapshot> CapturedEdgeData;
 	FOnCollectingMeshDataFinished OnCollectingDataFinished{};
-	FTimerHandle CollectVerticesTimerHandle{};
-	FTimerHandle InvalidateHitProxiesTimerHandle{};
 	bool bIsModeOn{false};
 	
 private:
 	FAxisDragger* AxisDragger;
 	const FSceneView* EdModeView;
+	/** Projection of the last rendered view, used by the collector thread */
+	TOptional<FMeshDataIterators::FViewProjection> LastViewProjection;
 	FDragTransaction DragTransaction;
 
 	bool bPreviousDroppingPreview{false};
 	bool bIsLeftMouseButtonDown{false};
-	bool bDataCollectionInProgress{false};
-	bool bIsMouseMove{false};
+	std::atomic<bool> bDataCollectionInProgress{false};
+	/** Set when the tracked components changed as a whole */
+	bool bCollectionRequested{false};
+	/** Set when the view changed and collected edges must be reprojected */
+	bool bViewDirty{false};
+	/** Whether the screen space stage runs. Camera moves cost nothing while it is off */
+	bool bScreenEdgesRequired{false};
+	/** Hover picking reads the projected edges while the cursor is inside a viewport */
+	bool bCursorInViewport{false};
 	bool bIsTracking = false;
 
 	float DPIScale{1.f};
 	FVector2D MouseOnScreenPosition{};
+	/** Edge and vertex under the cursor, indices into the snapshot currently read */
+	FMeshEdgePickResult HoveredEdge;
+	FMeshVertexPickResult HoveredVertex;
+	/** Incremented whenever a newly published snapshot is read */
+	uint32 SnapshotSerial{0};
+	/** Cursor position, snapshot and view the hovered elements were picked with */
+	FVector2D HoverPickPosition{};
+	uint32 HoverPickSnapshotSerial{0};
+	TOptional<FMeshDataIterators::FViewProjection> HoverPickView;
+
+	/** Endpoints of the edges of the selected loop or ring in world space, two per edge */
+	TArray<FVector> SelectedLoopPositions;
+	/** Normal of the selected loop, or the average direction of the edges of the selected ring */
+	FVector SelectedLoopAxis{FVector::ZeroVector};
+	TObjectKey<UPrimitiveComponent> SelectedLoopComponent;
+	/** Topology of the last skinned or dynamic mesh a loop was selected on, those are not cached per asset */
+	FMeshSourceDataPtr LoopTopologySource;
+	TSharedPtr<const FMeshTopology, ESPMode::ThreadSafe> LoopTopology;
+	/** Static mesh LOD whose topology was last built ahead of a double click */
+	TPair<TObjectKey<UStaticMesh>, int32> PrewarmedTopologyKey;
 
 	UMeshGeoData* CurrentMeshData{nullptr};
+
+	FMeshEdgeCollector EdgeCollector;
+	/** Draws the published edges, rooted while the mode is active */
+	UMeshEdgeOverlayComponent* EdgeOverlay{nullptr};
+	/** Static mesh components, and skinned and dynamic mesh components read through FMeshSources */
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> TrackedComponents;
+	TSet<TObjectKey<UPrimitiveComponent>> DirtyComponents;
+	/** LOD the edges of each tracked component are collected from */
+	TMap<TObjectKey<UPrimitiveComponent>, int32> EdgeLODs;
+	FDelegateHandle ObjectPropertyChangedHandle;
 };
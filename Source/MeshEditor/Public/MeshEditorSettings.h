@@ -3,8 +3,19 @@
 #pragma once
 
 #include "Engine/DeveloperSettings.h"
+#include "MeshEdgeClass.h"
 #include "MeshEditorSettings.generated.h"
 
+/** How the mesh LOD whose edges are shown is chosen */
+UENUM()
+enum class EMeshEdgeLODSelection : uint8
+{
+	/** The finest LOD whose edges stay MeshEdgeLODPixelThreshold pixels apart on screen */
+	EdgeSpacing,
+	/** The LOD the renderer currently draws the mesh with, so the edges match the shaded surface */
+	Rendered,
+};
+
 UCLASS(Config = Plugins)
 class MESHEDITOR_API UMeshEditorSettings : public UDeveloperSettings
 {
@@ -12,9 +23,56 @@ class MESHEDITOR_API UMeshEditorSettings : public UDeveloperSettings
 public:
 	UPROPERTY(Config, EditAnywhere, Category = "ColorSettings|MeshEdgeSettings")
 	FColor MeshEdgeColor {FColor::Orange};
+
+	/** Color of the edge and vertex under the cursor */
+	UPROPERTY(Config, EditAnywhere, Category = "ColorSettings|MeshEdgeSettings")
+	FColor MeshEdgeHoverColor {FColor::Yellow};
+
+	/** Color of the selected edge loop or ring */
+	UPROPERTY(Config, EditAnywhere, Category = "ColorSettings|MeshEdgeSettings")
+	FColor MeshEdgeSelectionColor {FColor::Cyan};
 	
 	UPROPERTY(Config, EditAnywhere, Category = "ColorSettings|LineSettings")
 	float MeshEdgeThickness {1.0f};
+
+	/** Distance edges are pushed out of the surface along the vertex normals, keeps them from z-fighting the mesh */
+	UPROPERTY(Config, EditAnywhere, Category = "ColorSettings|LineSettings", meta = (ClampMin = "0.0"))
+	float MeshEdgeSurfaceOffset {0.5f};
+
+	/** Distance in pixels from the cursor within which edges and vertices are hovered and clicks snap to them */
+	UPROPERTY(Config, EditAnywhere, Category = "PickingSettings", meta = (ClampMin = "1.0"))
+	float MeshEdgePickRadius {6.0f};
 	
+	/** Hides edges whose adjacent triangles all face away from the camera, and keeps them from being picked */
+	UPROPERTY(Config, EditAnywhere, Category = "CullingSettings")
+	bool bCullBackFacingEdges {false};
+
+	/**
+	* Only shows the edges on the outline of the meshes as seen from the camera, along with their open borders.
+	* Recomputed whenever the camera moves.
+	*/
+	UPROPERTY(Config, EditAnywhere, Category = "CullingSettings")
+	bool bShowSilhouetteEdgesOnly {false};
+
+	/**
+	* Far away meshes show the edges of their finest LOD whose edges stay about this many pixels apart on screen.
+	* Zero always shows the first LOD.
+	*/
+	UPROPERTY(Config, EditAnywhere, Category = "CullingSettings",
+		meta = (ClampMin = "0.0", EditCondition = "MeshEdgeLODSelection == EMeshEdgeLODSelection::EdgeSpacing"))
+	float MeshEdgeLODPixelThreshold {4.0f};
+
+	UPROPERTY(Config, EditAnywhere, Category = "CullingSettings")
+	EMeshEdgeLODSelection MeshEdgeLODSelection {EMeshEdgeLODSelection::EdgeSpacing};
+
+	/** Kinds of edges collected, drawn and picked. Leaving out smooth edges thins dense meshes out the most */
+	UPROPERTY(Config, EditAnywhere, Category = "CullingSettings",
+		meta = (Bitmask, BitmaskEnum = "/Script/MeshEditor.EMeshEdgeClass"))
+	int32 MeshEdgeClasses {static_cast<int32>(EMeshEdgeClass::All)};
+
+	/** Angle in degrees between the vertex normals on either side of an edge above which it is a crease */
+	UPROPERTY(Config, EditAnywhere, Category = "CullingSettings", meta = (ClampMin = "0.0", ClampMax = "180.0"))
+	float MeshEdgeCreaseAngle {30.0f};
+
 	static const UMeshEditorSettings* Get();
 };